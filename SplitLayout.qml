@@ -0,0 +1,58 @@
+import QtQuick 2.15
+
+import com.vtk.example 1.0
+
+// Lays the panes of a SplitLayoutModel (see src/SplitLayoutModel.h) out, with a handle between each two of them.
+//
+// Every pane is one instance of paneDelegate (a SplitPane) from its split to its unsplit: changing the layout
+// only moves and resizes the instances, so their content (e.g. a MyVtkItem and its VTK state) survives.
+Item {
+    id: root
+    objectName: "SplitLayout_root"
+
+    property SplitLayoutModel model: SplitLayoutModel {}
+    property Component paneDelegate: null
+    property int handleWidth: 6
+
+    Repeater {
+        model: root.model.panes
+        delegate: root.paneDelegate
+    }
+
+    Repeater {
+        model: root.model.handles
+
+        delegate: MouseArea {
+            id: handle
+
+            required property int index
+            required property rect rect
+            required property int orientation
+
+            readonly property bool horizontal: orientation === Qt.Horizontal
+
+            // Above the panes, which are created later
+            z: 1
+            x: Math.round(rect.x * root.width) - (horizontal ? root.handleWidth / 2 : 0)
+            y: Math.round(rect.y * root.height) - (horizontal ? 0 : root.handleWidth / 2)
+            width: horizontal ? root.handleWidth : Math.round((rect.x + rect.width) * root.width) - Math.round(rect.x * root.width)
+            height: horizontal ? Math.round((rect.y + rect.height) * root.height) - Math.round(rect.y * root.height) : root.handleWidth
+
+            hoverEnabled: true
+            preventStealing: true
+            cursorShape: horizontal ? Qt.SplitHCursor : Qt.SplitVCursor
+
+            onPositionChanged: function(mouse) {
+                if (!pressed)
+                    return
+                var p = mapToItem(root, mouse.x, mouse.y)
+                root.model.moveHandle(index, horizontal ? p.x / root.width : p.y / root.height)
+            }
+
+            Rectangle {
+                anchors.fill: parent
+                color: handle.pressed ? "#80ffffff" : handle.containsMouse ? "#40ffffff" : "transparent"
+            }
+        }
+    }
+}
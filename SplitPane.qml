@@ -0,0 +1,39 @@
+import QtQuick 2.15
+
+// The base of a SplitLayout's paneDelegate: placed at its pane's rect, split() and unsplit() act on its pane
+Item {
+    id: root
+    objectName: "pane " + paneId
+
+    required property int paneId
+    required property rect rect
+
+    // The SplitLayout we're a pane of, the delegates of a Repeater are children of the Repeater's parent
+    readonly property var layout: parent && parent.model ? parent : null
+    readonly property bool focused: layout ? layout.model.focused === paneId : false
+
+    x: layout ? Math.round(rect.x * layout.width) : 0
+    y: layout ? Math.round(rect.y * layout.height) : 0
+    width: layout ? Math.round((rect.x + rect.width) * layout.width) - x : 0
+    height: layout ? Math.round((rect.y + rect.height) * layout.height) - y : 0
+
+    function split(orientation) {
+        if (layout)
+            layout.model.split(paneId, orientation)
+        else
+            console.warn("YIKES!! SplitPane.split() called when this item is NOT inside a SplitLayout")
+    }
+
+    function unsplit() {
+        if (layout)
+            layout.model.unsplit(paneId)
+        else
+            console.warn("YIKES!! SplitPane.unsplit() called when this item is NOT inside a SplitLayout")
+    }
+
+    // Makes this the focused pane
+    function activate() {
+        if (layout)
+            layout.model.focused = paneId
+    }
+}
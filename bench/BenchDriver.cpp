@@ -0,0 +1,166 @@
+#include "BenchDriver.h"
+#include "FrameStats.h"
+
+#include "src/MyVtkItem.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtGui/QMouseEvent>
+#include <QtQuick/QQuickWindow>
+
+#include <cmath>
+
+BenchDriver::BenchDriver(QQuickWindow* w, FrameStats* s, Options o, QObject* parent)
+    : QObject(parent)
+    , window(w)
+    , stats(s)
+    , options(std::move(o))
+{
+    phaseIds[Warmup] = stats->addPhase("warmup");
+    phaseIds[Split] = stats->addPhase("split");
+    phaseIds[Orbit] = stats->addPhase("orbit");
+    phaseIds[Switch] = stats->addPhase("switch");
+    phaseIds[Unsplit] = stats->addPhase("unsplit");
+}
+
+void BenchDriver::start()
+{
+    // frameSwapped is emitted on the render thread, step on the GUI thread
+    connect(window, &QQuickWindow::frameSwapped, this, &BenchDriver::step, Qt::QueuedConnection);
+    enter(Warmup);
+    window->update();
+}
+
+void BenchDriver::enter(Phase p)
+{
+    phase = p;
+    idle = pane = frame = source = 0;
+
+    if (phase == Done) {
+        stats->setPhase(-1);
+        emit finished();
+        return;
+    }
+
+    stats->setPhase(phaseIds[phase]);
+    qInfo().noquote() << "bench:" << QStringList{ "warmup", "split", "orbit", "switch", "unsplit" }[phase];
+}
+
+QList<MyVtkItem*> BenchDriver::panes() const
+{
+    // Depth first, i.e. in the order the panes were created (see SplitLayoutPanes)
+    QList<MyVtkItem*> result;
+    QList<QQuickItem*> stack{ window->contentItem() };
+    while (!stack.isEmpty()) {
+        auto* item = stack.takeLast();
+        if (auto* vtk = qobject_cast<MyVtkItem*>(item))
+            result << vtk;
+        auto children = item->childItems();
+        for (auto it = children.rbegin(); it != children.rend(); ++it)
+            stack << *it;
+    }
+    return result;
+}
+
+bool BenchDriver::settled()
+{
+    for (auto* item : panes())
+        if (item->status() == MyVtkItem::Loading)
+            return false;
+    return ++idle >= options.settleFrames;
+}
+
+void BenchDriver::sendMouse(int type, QPointF scenePos, Qt::MouseButtons buttons)
+{
+    QMouseEvent e(QEvent::Type(type), scenePos, scenePos, window->mapToGlobal(scenePos),
+        type == QEvent::MouseMove ? Qt::NoButton : Qt::LeftButton, buttons, Qt::NoModifier);
+    QCoreApplication::sendEvent(window, &e);
+}
+
+void BenchDriver::step()
+{
+    if (phase == Done)
+        return;
+
+    auto* root = window;
+    auto items = panes();
+
+    switch (phase)
+    {
+    case Warmup:
+        if (settled())
+            enter(Split);
+        break;
+
+    case Split:
+        if (items.size() < options.panes) {
+            QMetaObject::invokeMethod(root, "split",
+                Q_ARG(QVariant, QVariant::fromValue<QObject*>(items.last())),
+                Q_ARG(QVariant, int(items.size() % 2 ? Qt::Horizontal : Qt::Vertical)));
+            idle = 0;
+        }
+        else if (settled())
+            enter(Orbit);
+        break;
+
+    case Orbit:
+    {
+        if (pane >= items.size()) {
+            if (settled())
+                enter(Switch);
+            break;
+        }
+
+        auto* item = items[pane];
+        auto center = item->mapToScene(QPointF(item->width() / 2, item->height() / 2));
+        auto radius = qMin(item->width(), item->height()) / 4;
+
+        if (frame == 0)
+            sendMouse(QEvent::MouseButtonPress, center, Qt::LeftButton);
+
+        constexpr double pi = 3.14159265358979323846;
+        auto angle = 2 * pi * frame / options.orbitFrames;
+        auto pos = center + QPointF(radius * (std::cos(angle) - 1), radius * std::sin(angle));
+        sendMouse(QEvent::MouseMove, pos, Qt::LeftButton);
+
+        if (++frame > options.orbitFrames) {
+            sendMouse(QEvent::MouseButtonRelease, pos, Qt::NoButton);
+            frame = 0;
+            ++pane;
+        }
+        break;
+    }
+
+    case Switch:
+        if (frame == 0) {
+            if (source >= options.sources.size()) {
+                enter(Unsplit);
+                break;
+            }
+            root->setProperty("source", options.sources[source]);
+            frame = 1;
+            idle = 0;
+        }
+        else if (settled()) {
+            frame = 0;
+            ++source;
+        }
+        break;
+
+    case Unsplit:
+        if (items.size() > 1) {
+            QMetaObject::invokeMethod(root, "unsplit", Q_ARG(QVariant, QVariant::fromValue<QObject*>(items.last())));
+            idle = 0;
+        }
+        else if (settled())
+            enter(Done);
+        break;
+
+    case Done:
+        break;
+    }
+
+    // Keep frames coming even when nothing changed, e.g. while waiting for a source to load
+    if (phase != Done)
+        window->update();
+}
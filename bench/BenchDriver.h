@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QPointF>
+#include <QtCore/QStringList>
+
+class FrameStats;
+class MyVtkItem;
+class QQuickWindow;
+
+/**
+* Drives the scripted benchmark scenario, one step per rendered frame:
+*
+*   warmup  -> wait for the first pane to be loaded
+*   split   -> split the last pane (alternating orientation) until there are `panes` panes
+*   orbit   -> drag the mouse in a circle over each pane in turn, `orbitFrames` frames per pane
+*   switch  -> switch all panes to each of `sources` in turn, waiting for them to be loaded
+*   unsplit -> unsplit the last pane until only one is left
+*
+* Between phases the driver idles for a few frames so deferred reallocations (see QQuickVtkItem) settle.
+*/
+class BenchDriver : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options
+    {
+        int panes = 8;
+        int orbitFrames = 120;
+        int settleFrames = 20;
+        QStringList sources;
+    };
+
+    BenchDriver(QQuickWindow* window, FrameStats* stats, Options options, QObject* parent = nullptr);
+
+    void start();
+
+Q_SIGNALS:
+    void finished();
+
+private:
+    enum Phase { Warmup, Split, Orbit, Switch, Unsplit, Done };
+
+    void step();
+    void enter(Phase phase);
+    bool settled();
+
+    QList<MyVtkItem*> panes() const;
+    void sendMouse(int type, QPointF scenePos, Qt::MouseButtons buttons);
+
+    QQuickWindow* window;
+    FrameStats* stats;
+    Options options;
+
+    Phase phase = Warmup;
+    int phaseIds[Done] = {};
+    int idle = 0;
+    int pane = 0;
+    int frame = 0;
+    int source = 0;
+};
@@ -0,0 +1,117 @@
+#include "FrameStats.h"
+
+#include <QtCore/QJsonArray>
+#include <QtQuick/QQuickWindow>
+
+#include <algorithm>
+#include <cmath>
+
+FrameStats::FrameStats(QQuickWindow* window, QObject* parent)
+    : QObject(parent)
+{
+    clock.start();
+
+    connect(window, &QQuickWindow::beforeSynchronizing, this, [this] {
+        framePhase = phase.load();
+        syncBegin = clock.nsecsElapsed();
+        renderBegin = renderEnd = syncEnd = syncBegin;
+    }, Qt::DirectConnection);
+
+    connect(window, &QQuickWindow::afterSynchronizing, this, [this] {
+        syncEnd = clock.nsecsElapsed();
+    }, Qt::DirectConnection);
+
+    connect(window, &QQuickWindow::beforeRendering, this, [this] {
+        renderBegin = clock.nsecsElapsed();
+    }, Qt::DirectConnection);
+
+    connect(window, &QQuickWindow::afterRendering, this, [this] {
+        renderEnd = clock.nsecsElapsed();
+    }, Qt::DirectConnection);
+
+    connect(window, &QQuickWindow::frameSwapped, this, [this] {
+        // A frame without a sync (e.g. a pure expose) isn't ours to measure
+        if (!syncBegin)
+            return;
+
+        Sample s{ framePhase, syncEnd - syncBegin, renderEnd - renderBegin, clock.nsecsElapsed() - syncBegin };
+        syncBegin = 0;
+
+        QMutexLocker lock(&mutex);
+        samples.append(s);
+    }, Qt::DirectConnection);
+}
+
+int FrameStats::addPhase(QString const& name)
+{
+    phases << name;
+    return phases.size() - 1;
+}
+
+void FrameStats::setPhase(int p)
+{
+    phase = p;
+}
+
+int FrameStats::frames() const
+{
+    QMutexLocker lock(&mutex);
+    return samples.size();
+}
+
+static QJsonObject percentiles(QVector<qint64> v)
+{
+    QJsonObject o;
+    if (v.isEmpty())
+        return o;
+
+    std::sort(v.begin(), v.end());
+
+    auto ms = [](qint64 ns) { return double(ns) / 1e6; };
+    auto rank = [&v](double p) { return v[qBound(0, int(std::ceil(p * v.size())) - 1, int(v.size()) - 1)]; };
+
+    double sum = 0;
+    for (auto x : v)
+        sum += x;
+
+    o["p50"] = ms(rank(0.50));
+    o["p90"] = ms(rank(0.90));
+    o["p95"] = ms(rank(0.95));
+    o["p99"] = ms(rank(0.99));
+    o["max"] = ms(v.last());
+    o["mean"] = ms(qint64(sum / v.size()));
+    return o;
+}
+
+QJsonObject FrameStats::report(int phase) const
+{
+    QVector<qint64> sync, render, total;
+    for (auto const& s : samples) {
+        if (phase >= 0 && s.phase != phase)
+            continue;
+        sync << s.sync;
+        render << s.render;
+        total << s.total;
+    }
+
+    QJsonObject o;
+    o["frames"] = int(total.size());
+    o["sync"] = percentiles(sync);
+    o["render"] = percentiles(render);
+    o["total"] = percentiles(total);
+    return o;
+}
+
+QJsonObject FrameStats::report() const
+{
+    QMutexLocker lock(&mutex);
+
+    QJsonObject perPhase;
+    for (int i = 0; i < phases.size(); ++i)
+        perPhase[phases[i]] = report(i);
+
+    QJsonObject o;
+    o["all"] = report(-1);
+    o["phases"] = perPhase;
+    return o;
+}
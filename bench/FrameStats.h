@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonObject>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+#include <atomic>
+
+class QQuickWindow;
+
+/**
+* Records per-frame timings of a QQuickWindow.
+*
+*   sync:   beforeSynchronizing -> afterSynchronizing (all updatePaintNode() calls)
+*   render: beforeRendering -> afterRendering (VTK renders in beforeRendering, then the scene graph draws)
+*   total:  beforeSynchronizing -> frameSwapped
+*
+* \note The window signals are emitted on the QML render thread, so FrameStats must be attached before the
+*       scene graph connects its own beforeRendering handlers (i.e. before the window is first exposed) for
+*       the render time to include VTK.
+*/
+class FrameStats : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FrameStats(QQuickWindow* window, QObject* parent = nullptr);
+
+    /**
+    * Samples are tagged with the current phase, which can be changed from the GUI thread at any time.
+    */
+    int addPhase(QString const& name);
+    void setPhase(int phase);
+
+    int frames() const;
+
+    /**
+    * The nearest-rank percentiles (in milliseconds) of all samples, overall and per phase.
+    */
+    QJsonObject report() const;
+
+private:
+    struct Sample
+    {
+        int phase;
+        qint64 sync;
+        qint64 render;
+        qint64 total;
+    };
+
+    QJsonObject report(int phase) const;
+
+    QElapsedTimer clock;
+    std::atomic<int> phase{ -1 };
+    QStringList phases;
+
+    // Written on the render thread only
+    int framePhase = -1;
+    qint64 syncBegin = 0;
+    qint64 syncEnd = 0;
+    qint64 renderBegin = 0;
+    qint64 renderEnd = 0;
+
+    mutable QMutex mutex;
+    QVector<Sample> samples;
+};
@@ -0,0 +1,36 @@
+import QtQuick 2.15
+import QtQuick.Window 2.15
+
+import com.vtk.example 1.0
+
+// Driven by BenchDriver, see bench/BenchDriver.h
+Window {
+    id: root
+    visible: true
+    width: benchWidth
+    height: benchHeight
+    title: "MultiViewsBench"
+
+    property string source: benchSource
+
+    function split(vtkItem, orientation) {
+        vtkItem.parent.split(orientation)
+    }
+
+    function unsplit(vtkItem) {
+        vtkItem.parent.unsplit()
+    }
+
+    SplitLayout {
+        anchors.fill: parent
+
+        paneDelegate: SplitPane {
+            MyVtkItem {
+                anchors.fill: parent
+                source: root.source
+                adaptiveQuality: benchAdaptiveQuality
+                threadedRendering: benchThreaded
+            }
+        }
+    }
+}
@@ -0,0 +1,143 @@
+#include "BenchDriver.h"
+#include "FrameStats.h"
+
+#include "src/GeometryCache.h"
+#include "src/MyVtkItem.h"
+#include "src/SplitLayoutModel.h"
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QTimer>
+#include <QtGui/QGuiApplication>
+#include <QtQml/QQmlApplicationEngine>
+#include <QtQml/QQmlContext>
+#include <QtQuick/QQuickWindow>
+
+#include <QVTKRenderWindowAdapter.h>
+
+#include <vtkSphereSource.h>
+
+#include <cstdio>
+
+int main(int argc, char* argv[])
+{
+    // Headless by default: the offscreen platform plugin and Mesa's llvmpipe, no GPU nor display needed.
+    // Set QT_QPA_PLATFORM (e.g. "xcb" or "windows") to benchmark on a real GPU instead.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+        if (qEnvironmentVariableIsEmpty("LIBGL_ALWAYS_SOFTWARE"))
+            qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+    }
+
+    QQuickWindow::setGraphicsApi(QSGRendererInterface::OpenGLRhi);
+    QSurfaceFormat::setDefaultFormat(QVTKRenderWindowAdapter::defaultFormat());
+
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName("MultiViewsBench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the sync, render and total frame times of N MyVtkItem panes");
+    parser.addHelpOption();
+    QCommandLineOption panesOption("panes", "Number of panes.", "n", "8");
+    QCommandLineOption orbitOption("orbit-frames", "Frames per pane of mouse orbiting.", "n", "120");
+    QCommandLineOption settleOption("settle-frames", "Idle frames between steps.", "n", "20");
+    QCommandLineOption resolutionsOption("resolutions", "Comma separated resolutions of extra 'Sphere <r>' sources.", "list", "32,256,1024");
+    QCommandLineOption sourcesOption("sources", "Comma separated sources to switch through (default: all).", "list");
+    QCommandLineOption sizeOption("size", "Window size.", "WxH", "1280x960");
+    QCommandLineOption fixedQualityOption("fixed-quality", "Disable adaptiveQuality.");
+    QCommandLineOption threadedOption("threaded", "Enable threadedRendering: panes render on worker threads, panes showing the same source on the same one.");
+    QCommandLineOption outputOption({ "o", "output" }, "Write the JSON report to file instead of stdout.", "file");
+    QCommandLineOption timeoutOption("timeout", "Abort after this many seconds, 0 never does.", "s", "600");
+    parser.addOptions({ panesOption, orbitOption, settleOption, resolutionsOption, sourcesOption, sizeOption,
+        fixedQualityOption, threadedOption, outputOption, timeoutOption });
+    parser.process(app);
+
+    for (auto const& r : parser.value(resolutionsOption).split(',', Qt::SkipEmptyParts)) {
+        int resolution = r.toInt();
+        if (resolution < 3) {
+            qWarning() << "YIKES!! Ignoring bad resolution:'" << r << "'";
+            continue;
+        }
+        GeometryCache::instance().registerSource(QString("Sphere %1").arg(resolution), [resolution](QVector<double> const&) -> vtkSmartPointer<vtkPolyDataAlgorithm> {
+            auto sphere = vtkSmartPointer<vtkSphereSource>::New();
+            sphere->SetThetaResolution(resolution);
+            sphere->SetPhiResolution(resolution);
+            return sphere;
+        });
+    }
+
+    BenchDriver::Options options;
+    options.panes = qMax(1, parser.value(panesOption).toInt());
+    options.orbitFrames = qMax(1, parser.value(orbitOption).toInt());
+    options.settleFrames = qMax(1, parser.value(settleOption).toInt());
+    options.sources = parser.isSet(sourcesOption)
+        ? parser.value(sourcesOption).split(',', Qt::SkipEmptyParts)
+        : GeometryCache::instance().sources();
+    for (auto const& s : options.sources)
+        if (!GeometryCache::instance().contains(s)) {
+            qCritical() << "YIKES!! Unknown source:'" << s << "'";
+            return 1;
+        }
+
+    auto size = parser.value(sizeOption).split('x');
+    int width = size.value(0).toInt(), height = size.value(1).toInt();
+    if (width <= 0 || height <= 0) {
+        qCritical() << "YIKES!! Bad window size:'" << parser.value(sizeOption) << "'";
+        return 1;
+    }
+
+    qmlRegisterType<MyVtkItem>("com.vtk.example", 1, 0, "MyVtkItem");
+    qmlRegisterType<SplitLayoutModel>("com.vtk.example", 1, 0, "SplitLayoutModel");
+
+    QQmlApplicationEngine engine;
+    engine.rootContext()->setContextProperty("benchWidth", width);
+    engine.rootContext()->setContextProperty("benchHeight", height);
+    engine.rootContext()->setContextProperty("benchSource", options.sources.value(0));
+    engine.rootContext()->setContextProperty("benchAdaptiveQuality", !parser.isSet(fixedQualityOption));
+    engine.rootContext()->setContextProperty("benchThreaded", parser.isSet(threadedOption));
+    engine.load(QUrl(QStringLiteral("qrc:/bench.qml")));
+
+    auto* window = engine.rootObjects().isEmpty() ? nullptr : qobject_cast<QQuickWindow*>(engine.rootObjects().first());
+    if (!window)
+        return -1;
+
+    FrameStats stats(window);
+    BenchDriver driver(window, &stats, options);
+
+    QObject::connect(&driver, &BenchDriver::finished, &app, [&] {
+        QJsonObject report = stats.report();
+        report["platform"] = QGuiApplication::platformName();
+        report["panes"] = options.panes;
+        report["orbitFrames"] = options.orbitFrames;
+        report["sources"] = QJsonArray::fromStringList(options.sources);
+        report["size"] = parser.value(sizeOption);
+        report["adaptiveQuality"] = !parser.isSet(fixedQualityOption);
+        report["threadedRendering"] = parser.isSet(threadedOption);
+
+        auto json = QJsonDocument(report).toJson();
+        if (parser.isSet(outputOption)) {
+            QFile file(parser.value(outputOption));
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                qCritical() << "YIKES!! Can't write:'" << file.fileName() << "'";
+                QCoreApplication::exit(1);
+                return;
+            }
+            file.write(json);
+        }
+        else {
+            std::fwrite(json.constData(), 1, json.size(), stdout);
+        }
+        QCoreApplication::exit(0);
+    });
+
+    if (int timeout = parser.value(timeoutOption).toInt(); timeout > 0)
+        QTimer::singleShot(timeout * 1000, &app, [] {
+            qCritical() << "YIKES!! Benchmark timed out";
+            QCoreApplication::exit(2);
+        });
+
+    driver.start();
+    return app.exec();
+}
@@ -1,6 +1,12 @@
 #include "src/Presenter.h"
 #include "src/MyVtkItem.h"
+#include "src/MappedMesh.h"
+#include "src/PointCloud.h"
+#include "src/Session.h"
+#include "src/SplitLayoutModel.h"
+#include "src/TimeSeries.h"
 
+#include <QDir>
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQuickVTKRenderWindow.h>
@@ -10,6 +16,7 @@
 
 #include <QQmlContext>
 #include <QObject>
+#include <QStandardPaths>
 
 extern "C" {
     _declspec(dllexport) int NvOptimusEnablement = 1;
@@ -22,13 +29,31 @@ int main(int argc, char* argv[])
     QSurfaceFormat::setDefaultFormat(QVTKRenderWindowAdapter::defaultFormat());
 
     QGuiApplication app(argc, argv);
+
+    // Large meshes are converted to .mvmesh files (see tools/MeshConvert) and memory-mapped from this directory,
+    // point clouds to .mvoct files which are loaded node by node as the views need them. Its subdirectories are
+    // time series, one file per step.
+    auto meshes = qEnvironmentVariable("MULTIVIEWS_MESHES", QCoreApplication::applicationDirPath() + "/meshes");
+    registerMappedMeshes(meshes);
+    registerPointClouds(meshes);
+    registerTimeSeriesDirectories(meshes);
+
     Presenter presenter;
 
     qmlRegisterType<MyVtkItem>("com.vtk.example", 1, 0, "MyVtkItem");
+    qmlRegisterType<SplitLayoutModel>("com.vtk.example", 1, 0, "SplitLayoutModel");
+    qmlRegisterType<Session>("com.vtk.example", 1, 0, "Session");
     qmlRegisterUncreatableType<Presenter>("com.vtk.example", 1, 0, "Presenter", "!!");
 
     QQmlApplicationEngine engine;
     engine.rootContext()->setContextProperty("presenter", &presenter);
+
+    // A session snapshot given on the command line is restored on start, the Save/Restore buttons use the same file
+    auto sessions = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(sessions);
+    auto arguments = app.arguments();
+    engine.rootContext()->setContextProperty("sessionFile", arguments.size() > 1 ? arguments[1] : sessions + "/session.mvsession");
+    engine.rootContext()->setContextProperty("restoreSession", arguments.size() > 1);
     engine.load(QUrl(QStringLiteral("qrc:/main.qml")));
     if (engine.rootObjects().isEmpty()) {
         return -1;
@@ -24,22 +24,19 @@ ApplicationWindow {
                     id: btn1
                     text: "Split Horizontal"
                     rightPadding: 8
-                    onClicked: dsv.focused.split(Qt.Horizontal)
+                    onClicked: panes.split(panes.focused, Qt.Horizontal)
                 }
 
                 Button {
                     id: btn2
                     text: "Split Vertical"
-                    onClicked: dsv.focused.split(Qt.Vertical)
+                    onClicked: panes.split(panes.focused, Qt.Vertical)
                 }
 
                 Button {
                     id: btn3
                     text: "UnSplit"
-                    onClicked: {
-                        dsv.focused.unsplit();
-                        dsv.pop();
-                    }
+                    onClicked: panes.unsplit(panes.focused)
                 }
 
                 Component.onCompleted: {
@@ -50,6 +47,22 @@ ApplicationWindow {
                 }
             }
 
+            Rectangle {
+                color: "black"
+                Layout.preferredWidth: 1
+                Layout.fillHeight: true
+            }
+
+            Button {
+                text: "Save"
+                onClicked: session.save(sessionFile)
+            }
+
+            Button {
+                text: "Restore"
+                onClicked: session.restore(sessionFile)
+            }
+
             Item {
                 Layout.fillWidth: true
                 Layout.fillHeight: true
@@ -72,63 +85,112 @@ ApplicationWindow {
                 Layout.preferredWidth: childrenRect.width
                 model: presenter.sources
             }
-        }
-    }
-
-    DynamicSplitView {
-        id: dsv
-        anchors.fill: parent
 
-        property var focused: null
-        property var stack: []
+            CheckBox {
+                id: linked
+                text: "Link cameras"
+            }
 
-        function push(item) {
-            stack.push(item)
-            focused = item
+            CheckBox {
+                id: stats
+                text: "Stats"
+            }
         }
+    }
 
-        function pop() {
-            if (stack.length > 1) {
+    // The layout and the panes' sources, cameras and computed geometry, see src/Session.h
+    Session {
+        id: session
+        layout: panes
+        onSaved: function(fileName, ok) { console.log(ok ? "Saved the session to" : "YIKES!! Saving the session failed:", fileName) }
+    }
 
-                // remove all copies of the item at the top of the stack
-                stack = stack.filter(function(f) { return f !== focused});
+    Component.onCompleted: {
+        if (restoreSession)
+            session.restore(sessionFile)
+    }
 
-                // remove all duplicate runs of identical items in the stack
-                stack = stack.filter(function(item, pos, ary) { return !pos || item !== ary[pos - 1];});
+    SplitLayout {
+        anchors.fill: parent
 
-                // the new focused element is now at the top of the stack
-                focused = stack.length > 0 ? stack[stack.length -1] : null;
-            }
+        // Unsplitting the focused pane focuses the one focused before it
+        model: SplitLayoutModel {
+            id: panes
         }
 
-        itemDelegate: SplitViewItemDelegate {
+        paneDelegate: SplitPane {
             id: item
 
             Rectangle {
                 border {
                     id: border
                     width: 5;
-                    color: dsv.focused === item ? "goldenrod" : "steelblue"
+                    color: item.focused ? "goldenrod" : "steelblue"
                 }
                 radius: 5
                 color: "magenta"
                 anchors.fill: parent
 
                 MyVtkItem {
+                    id: vtkItem
                     anchors.fill: parent
                     anchors.margins: border.width
                     source: sources.currentText
-                    onClicked: {
-                        if (dsv.focused != item) {
-                            dsv.push(item);
-                        }
+                    adaptiveQuality: true
+                    targetFrameTime: 16
+                    linkGroup: linked.checked ? "panes" : ""
+                    onClicked: item.activate()
+                    focus: item.focused
+                    Component.onCompleted: session.attach(item.paneId, vtkItem)
+                }
+
+                // Time series only
+                RowLayout {
+                    anchors.bottom: parent.bottom
+                    anchors.left: parent.left
+                    anchors.right: parent.right
+                    anchors.margins: 10
+                    visible: vtkItem.times.length > 1 && vtkItem.status !== MyVtkItem.Loading
+
+                    Button {
+                        text: vtkItem.playing ? "Pause" : "Play"
+                        onClicked: vtkItem.playing = !vtkItem.playing
+                    }
+
+                    Slider {
+                        Layout.fillWidth: true
+                        from: vtkItem.times.length ? vtkItem.times[0] : 0
+                        to: vtkItem.times.length ? vtkItem.times[vtkItem.times.length - 1] : 1
+                        value: vtkItem.currentTime
+                        onMoved: vtkItem.currentTime = value
                     }
-                    focus: dsv.focused === item ? true : false
                 }
-            }
 
-            Component.onCompleted: {
-                dsv.push(item);
+                ProgressBar {
+                    anchors.bottom: parent.bottom
+                    anchors.left: parent.left
+                    anchors.right: parent.right
+                    anchors.margins: 10
+                    visible: vtkItem.status === MyVtkItem.Loading
+                    value: vtkItem.progress
+                }
+
+                Text {
+                    anchors.top: parent.top
+                    anchors.left: parent.left
+                    anchors.margins: 10
+                    visible: stats.checked
+                    color: "white"
+                    style: Text.Outline
+                    font.family: "monospace"
+                    text: "dispatch       " + vtkItem.dispatchTime.toFixed(2) + " ms\n"
+                        + "processEvents  " + vtkItem.processEventsTime.toFixed(2) + " ms\n"
+                        + "render         " + vtkItem.renderTime.toFixed(2) + " ms\n"
+                        + "rebuild        " + vtkItem.rebuildTime.toFixed(2) + " ms (" + vtkItem.rebuildCount + ")\n"
+                        + "queue          " + vtkItem.queueLength + "\n"
+                        + "shader cache   " + vtkItem.shaderCacheHits + " hits, " + vtkItem.shaderCacheMisses + " misses\n"
+                        + "dropped steps  " + vtkItem.droppedSteps
+                }
             }
         }
     }
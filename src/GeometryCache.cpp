@@ -0,0 +1,267 @@
+#include "GeometryCache.h"
+#include "QQuickVtkTrace.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtCore/QPointer>
+#include <QtCore/QThreadPool>
+
+#include <vtkCallbackCommand.h>
+
+#include <vtkCapsuleSource.h>
+#include <vtkConeSource.h>
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkQuadricDecimation.h>
+#include <vtkSphereSource.h>
+#include <vtkStaticCellLocator.h>
+#include <vtkTriangleFilter.h>
+
+struct GeometryCache::Entry
+{
+    Key key;
+    QMutex mutex;
+    bool computed = false;
+    vtkSmartPointer<vtkPolyData> polyData;
+
+    QMutex lodMutex;
+    bool lodComputed = false;
+    vtkSmartPointer<vtkPolyData> lod;
+
+    QMutex locatorMutex;
+    vtkSmartPointer<vtkStaticCellLocator> locator;
+};
+
+size_t qHash(GeometryCache::Key const& key, size_t seed) noexcept
+{
+    return qHashMulti(seed, key.source, key.params);
+}
+
+GeometryCache& GeometryCache::instance()
+{
+    static GeometryCache cache;
+    return cache;
+}
+
+GeometryCache::GeometryCache()
+{
+    registerSource("Cone", [](QVector<double> const&) -> vtkSmartPointer<vtkPolyDataAlgorithm> {
+        return vtkSmartPointer<vtkConeSource>::New();
+    });
+    registerSource("Sphere", [](QVector<double> const&) -> vtkSmartPointer<vtkPolyDataAlgorithm> {
+        return vtkSmartPointer<vtkSphereSource>::New();
+    });
+    registerSource("Capsule", [](QVector<double> const&) -> vtkSmartPointer<vtkPolyDataAlgorithm> {
+        return vtkSmartPointer<vtkCapsuleSource>::New();
+    });
+}
+
+void GeometryCache::registerSource(QString const& name, Factory factory)
+{
+    QMutexLocker lock(&mutex);
+
+    if (!factories.contains(name))
+        order << name;
+    factories.insert(name, std::move(factory));
+}
+
+bool GeometryCache::contains(QString const& name) const
+{
+    QMutexLocker lock(&mutex);
+    return factories.contains(name);
+}
+
+QStringList GeometryCache::sources() const
+{
+    QMutexLocker lock(&mutex);
+    return order;
+}
+
+int GeometryCache::size() const
+{
+    QMutexLocker lock(&mutex);
+
+    int n = 0;
+    for (auto const& e : entries)
+        n += !e.expired();
+    return n;
+}
+
+GeometryCache::Handle GeometryCache::acquire(Key const& key, std::function<void(double)> const& progress)
+{
+    std::shared_ptr<Entry> entry;
+    Factory factory;
+
+    {
+        QMutexLocker lock(&mutex);
+
+        // Forget about entries nobody holds anymore
+        for (auto it = entries.begin(); it != entries.end();)
+            it = it->expired() ? entries.erase(it) : std::next(it);
+
+        auto f = factories.constFind(key.source);
+        if (f == factories.cend())
+            return {};
+        factory = *f;
+
+        entry = entries.value(key).lock();
+        if (!entry) {
+            entry = std::make_shared<Entry>();
+            entry->key = key;
+            entries.insert(key, entry);
+        }
+    }
+
+    // Execute the source outside of the cache lock so other sources can be acquired concurrently. Only the
+    // first caller computes, the others wait here for its result.
+    QMutexLocker lock(&entry->mutex);
+    if (!entry->computed) {
+        entry->computed = true;
+        QQuickVtkTrace::Scope trace("source");
+
+        if (auto algorithm = factory(key.params)) {
+            vtkNew<vtkCallbackCommand> observer;
+            if (progress) {
+                observer->SetClientData(const_cast<std::function<void(double)>*>(&progress));
+                observer->SetCallback([](vtkObject*, unsigned long, void* clientData, void* callData) {
+                    (*static_cast<std::function<void(double)>*>(clientData))(*static_cast<double*>(callData));
+                });
+                algorithm->AddObserver(vtkCommand::ProgressEvent, observer);
+            }
+
+            algorithm->Update();
+            entry->polyData = vtkSmartPointer<vtkPolyData>::New();
+            entry->polyData->ShallowCopy(algorithm->GetOutput());
+        } else
+            qWarning() << Q_FUNC_INFO << "YIKES!! Factory for source:'" << key.source << "' returned no algorithm";
+    }
+
+    return Handle(std::move(entry));
+}
+
+void GeometryCache::acquireAsync(Key const& key, QObject* context, std::function<void(Handle)> done, std::function<void(double)> progress)
+{
+    QThreadPool::globalInstance()->start([this, key, ctx = QPointer<QObject>(context), done = std::move(done), progress = std::move(progress)] {
+        std::function<void(double)> report;
+        if (progress)
+            report = [ctx, progress](double value) {
+                QMetaObject::invokeMethod(qApp, [ctx, progress, value] {
+                    if (ctx)
+                        progress(value);
+                    }, Qt::QueuedConnection);
+            };
+
+        auto handle = acquire(key, report);
+
+        QMetaObject::invokeMethod(qApp, [ctx, done, handle] {
+            if (ctx)
+                done(handle);
+            }, Qt::QueuedConnection);
+        });
+}
+
+GeometryCache::Handle GeometryCache::find(Key const& key) const
+{
+    std::shared_ptr<Entry> entry;
+    {
+        QMutexLocker lock(&mutex);
+        entry = entries.value(key).lock();
+    }
+
+    // Locked while the source executes
+    if (!entry || !entry->mutex.tryLock())
+        return {};
+    bool computed = entry->computed;
+    entry->mutex.unlock();
+
+    return computed ? Handle(std::move(entry)) : Handle();
+}
+
+GeometryCache::Handle GeometryCache::insert(Key const& key, vtkSmartPointer<vtkPolyData> polyData, bool decimated, vtkSmartPointer<vtkPolyData> lod)
+{
+    QMutexLocker lock(&mutex);
+
+    for (auto it = entries.begin(); it != entries.end();)
+        it = it->expired() ? entries.erase(it) : std::next(it);
+
+    if (auto entry = entries.value(key).lock())
+        return Handle(std::move(entry));
+
+    auto entry = std::make_shared<Entry>();
+    entry->key = key;
+    entry->computed = polyData != nullptr;
+    entry->polyData = std::move(polyData);
+    entry->lodComputed = decimated;
+    entry->lod = decimated ? std::move(lod) : nullptr;
+    entries.insert(key, entry);
+    return Handle(std::move(entry));
+}
+
+vtkPolyData* GeometryCache::Handle::polyData() const
+{
+    return entry ? entry->polyData.Get() : nullptr;
+}
+
+GeometryCache::Key const* GeometryCache::Handle::key() const
+{
+    return entry ? &entry->key : nullptr;
+}
+
+vtkPolyData* GeometryCache::Handle::decimated() const
+{
+    if (!entry || !entry->polyData)
+        return nullptr;
+
+    QMutexLocker lock(&entry->lodMutex);
+    if (!entry->lodComputed) {
+        entry->lodComputed = true;
+
+        auto cells = entry->polyData->GetNumberOfCells();
+        if (cells > LodCellBudget) {
+            QQuickVtkTrace::Scope trace("decimate");
+            vtkNew<vtkTriangleFilter> triangles;
+            triangles->SetInputData(entry->polyData);
+
+            vtkNew<vtkQuadricDecimation> decimation;
+            decimation->SetInputConnection(triangles->GetOutputPort());
+            decimation->SetTargetReduction(1.0 - double(LodCellBudget) / cells);
+            decimation->Update();
+
+            entry->lod = vtkSmartPointer<vtkPolyData>::New();
+            entry->lod->ShallowCopy(decimation->GetOutput());
+        }
+    }
+    return entry->lod;
+}
+
+bool GeometryCache::Handle::isDecimated() const
+{
+    if (!entry || !entry->lodMutex.tryLock())
+        return false;
+    bool computed = entry->lodComputed;
+    entry->lodMutex.unlock();
+    return computed;
+}
+
+vtkAbstractCellLocator* GeometryCache::Handle::locator() const
+{
+    if (!entry || !entry->polyData)
+        return nullptr;
+
+    QMutexLocker lock(&entry->locatorMutex);
+    if (!entry->locator) {
+        QQuickVtkTrace::Scope trace("locator");
+
+        // On a copy sharing the arrays, whose cell map is built right here: queries only read it then and don't race
+        // with whoever else builds the shared polyData's
+        vtkNew<vtkPolyData> polyData;
+        polyData->ShallowCopy(entry->polyData);
+        polyData->BuildCells();
+
+        entry->locator = vtkSmartPointer<vtkStaticCellLocator>::New();
+        entry->locator->SetDataSet(polyData);
+        entry->locator->BuildLocator();
+    }
+    return entry->locator;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+#include <vtkSmartPointer.h>
+
+#include <functional>
+#include <memory>
+
+class QObject;
+class vtkAbstractCellLocator;
+class vtkPolyData;
+class vtkPolyDataAlgorithm;
+
+/**
+* Process-wide, reference counted cache of computed vtkPolyData.
+*
+* Every view asking for the same source (name + parameters) is handed the very same output vtkPolyData, so the
+* source is executed once and its arrays live in memory once, no matter how many panes show it.
+*
+* \note Entries are owned by the Handle objects returned from acquire(). When the last Handle of an entry is
+*       destroyed the entry (and with it the cache's reference to the vtkPolyData) is released.
+*
+* \note The cache is thread safe. The source is executed on the thread calling acquire().
+*/
+class GeometryCache
+{
+public:
+    struct Key
+    {
+        QString source;
+        QVector<double> params;
+
+        bool operator==(Key const& o) const { return source == o.source && params == o.params; }
+    };
+
+    using Factory = std::function<vtkSmartPointer<vtkPolyDataAlgorithm>(QVector<double> const& params)>;
+
+    enum { LodCellBudget = 100000 };
+
+private:
+    struct Entry;
+
+public:
+    class Handle
+    {
+    public:
+        Handle() = default;
+
+        vtkPolyData* polyData() const;
+        Key const* key() const;
+
+        /**
+        * Returns a decimated copy of polyData() with about LodCellBudget cells, or nullptr if polyData() is small
+        * enough to be rendered as is. The copy is computed on first use (blocking, so call this from a worker
+        * thread) and shared by all holders of the entry.
+        */
+        vtkPolyData* decimated() const;
+
+        // Whether decimated() has been computed already, i.e. returns right away
+        bool isDecimated() const;
+
+        /**
+        * Returns a vtkStaticCellLocator of polyData(), e.g. for picking, or nullptr if there is no polyData(). It's
+        * built on first use (blocking, so call this from a worker thread) and shared by all holders of the entry.
+        *
+        * \note Query it with the thread safe overloads, the ones taking a vtkGenericCell. Its GetDataSet() shares
+        *       the arrays of polyData() and has its cells built, so its GetCellPoints() is thread safe too.
+        */
+        vtkAbstractCellLocator* locator() const;
+
+        explicit operator bool() const { return bool(entry); }
+
+    private:
+        friend class GeometryCache;
+        explicit Handle(std::shared_ptr<Entry> e) : entry(std::move(e)) {}
+
+        std::shared_ptr<Entry> entry;
+    };
+
+    static GeometryCache& instance();
+
+    /**
+    * Registers a named source. The factory must return a configured (but not yet executed) algorithm.
+    */
+    void registerSource(QString const& name, Factory factory);
+
+    bool contains(QString const& name) const;
+    QStringList sources() const;
+
+    /**
+    * Returns a handle on the computed output of the source described by key, executing the source if no other
+    * view currently holds it. Returns an empty handle if the source name is unknown.
+    *
+    * \param progress Called with values in [0, 1] while the source executes (on the executing thread)
+    */
+    Handle acquire(Key const& key, std::function<void(double)> const& progress = {});
+
+    /**
+    * Like acquire() but executes the source on the global thread pool.
+    *
+    * \note done and progress are invoked on the GUI thread, and only as long as context is alive.
+    */
+    void acquireAsync(Key const& key, QObject* context, std::function<void(Handle)> done, std::function<void(double)> progress = {});
+
+    /**
+    * Returns a handle on the entry of key if some view holds it and it has been computed, without executing
+    * anything. Returns an empty handle otherwise, e.g. while the source still executes.
+    */
+    Handle find(Key const& key) const;
+
+    /**
+    * Adds an entry computed elsewhere, e.g. read back from a session snapshot (see Session). polyData is the
+    * output of the source, nullptr to execute the source on the first acquire() as usual. If decimated is true
+    * lod is what decimated() returns.
+    *
+    * \note An entry some view holds already is kept and returned as is.
+    */
+    Handle insert(Key const& key, vtkSmartPointer<vtkPolyData> polyData, bool decimated, vtkSmartPointer<vtkPolyData> lod);
+
+    /**
+    * The number of live entries, mostly for diagnostics.
+    */
+    int size() const;
+
+private:
+    GeometryCache();
+    Q_DISABLE_COPY(GeometryCache)
+
+    mutable QMutex mutex;
+    QStringList order;
+    QHash<QString, Factory> factories;
+    QHash<Key, std::weak_ptr<Entry>> entries;
+};
+
+size_t qHash(GeometryCache::Key const& key, size_t seed = 0) noexcept;
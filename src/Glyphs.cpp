@@ -0,0 +1,63 @@
+#include "Glyphs.h"
+#include "GeometryCache.h"
+
+#include <vtkFloatArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkUnsignedCharArray.h>
+
+static const QString s_prefix = QStringLiteral("Glyphs:");
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+namespace
+{
+    // An array over data, which VTK won't free (nor write)
+    template<typename Array, typename T>
+    vtkSmartPointer<Array> wrap(QVector<T> const& data, int components, const char* name)
+    {
+        auto array = vtkSmartPointer<Array>::New();
+        array->SetName(name);
+        array->SetNumberOfComponents(components);
+        array->SetArray(const_cast<T*>(data.constData()), vtkIdType(data.size()), 1);
+        return array;
+    }
+}
+
+bool GlyphInstances::isValid() const
+{
+    auto n = count();
+    return positions.size() == 3 * n
+        && (colors.isEmpty() || colors.size() == 4 * n)
+        && (scales.isEmpty() || scales.size() == n)
+        && (orientations.isEmpty() || orientations.size() == 4 * n);
+}
+
+void GlyphInstances::apply(vtkPolyData* polyData) const
+{
+    vtkNew<vtkPoints> points;
+    points->SetData(wrap<vtkFloatArray>(positions, 3, "position"));
+    polyData->SetPoints(points);
+
+    auto* pointData = polyData->GetPointData();
+    pointData->Initialize();
+    if (!colors.isEmpty())
+        pointData->AddArray(wrap<vtkUnsignedCharArray>(colors, 4, "color"));
+    if (!scales.isEmpty())
+        pointData->AddArray(wrap<vtkFloatArray>(scales, 1, "scale"));
+    if (!orientations.isEmpty())
+        pointData->AddArray(wrap<vtkFloatArray>(orientations, 4, "orientation"));
+
+    polyData->Modified();
+}
+
+QString glyphShape(QString const& source)
+{
+    if (!source.startsWith(s_prefix))
+        return {};
+
+    auto shape = source.mid(s_prefix.size());
+    return GeometryCache::instance().contains(shape) ? shape : QString();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+class vtkPolyData;
+
+/**
+* The instances of a glyph source (see glyphShape()): one shape drawn at every position, e.g. markers or particles,
+* with an optional color, scale and orientation per instance. MyVtkItem draws them in a single instanced draw call
+* (see vtkGlyph3DMapper), the shape's geometry is built once and never touched by updates.
+*
+* The arrays are implicitly shared: apply() hands their memory to VTK without copying and the render thread keeps
+* its own reference, so the application may go on filling its copy on any thread (which then detaches from ours).
+*/
+struct GlyphInstances
+{
+    QVector<float> positions;       // x, y, z per instance
+    QVector<quint8> colors;         // r, g, b, a per instance, or empty for the actor's color
+    QVector<float> scales;          // per instance, or empty to draw the shape at its size
+    QVector<float> orientations;    // a unit quaternion w, x, y, z per instance, or empty to keep the shape's
+
+    qsizetype count() const { return positions.size() / 3; }
+
+    // Whether every array holds count() instances (or is empty, if optional)
+    bool isValid() const;
+
+    /**
+    * Points polyData at the arrays: its points are the positions and its point data has the arrays "color",
+    * "scale" and "orientation", those which aren't empty.
+    *
+    * \note The arrays must outlive polyData's use of them, i.e. this must not be changed or destroyed until
+    *       another apply() replaced them.
+    */
+    void apply(vtkPolyData* polyData) const;
+};
+
+/**
+* The shape of a glyph source, i.e. the GeometryCache source it draws once per instance, or an empty string if
+* source isn't a glyph source. Glyph sources are named "Glyphs:<shape>", e.g. "Glyphs:Sphere".
+*/
+QString glyphShape(QString const& source);
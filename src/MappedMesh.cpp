@@ -0,0 +1,649 @@
+#include "MappedMesh.h"
+#include "GeometryCache.h"
+
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSaveFile>
+#include <QtCore/QVector>
+
+#include <vtkCellArray.h>
+#include <vtkFloatArray.h>
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+
+static const char s_magic[8] = { 'M', 'V', 'M', 'E', 'S', 'H', 0, 0 };
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+namespace
+{
+    // Every array pointing into a mapping holds a reference to it, the file is unmapped with the last one.
+    //
+    // Note: vtkAbstractArray's free function only gets the array's pointer, so we look the mapping up by it. Arrays
+    //       may share a pointer, e.g. those of the same mesh read twice from a snapshot, so it's counted.
+    struct Mapping
+    {
+        QFile file;
+        uchar* data = nullptr;
+    };
+
+    struct MappingRef
+    {
+        std::shared_ptr<Mapping> mapping;
+        int arrays = 0;
+    };
+
+    QMutex s_mutex;
+    QHash<void*, MappingRef> s_mappings;
+
+    void releaseMapping(void* ptr)
+    {
+        QMutexLocker lock(&s_mutex);
+        if (auto it = s_mappings.find(ptr); it != s_mappings.end() && --it->arrays == 0)
+            s_mappings.erase(it);
+    }
+
+    template<class Array>
+    vtkSmartPointer<Array> wrap(std::shared_ptr<Mapping> const& mapping, quint64 offset, vtkIdType components, vtkIdType tuples)
+    {
+        auto* ptr = reinterpret_cast<typename Array::ValueType*>(mapping->data + offset);
+
+        {
+            QMutexLocker lock(&s_mutex);
+            auto& ref = s_mappings[ptr];
+            ref.mapping = mapping;
+            ++ref.arrays;
+        }
+
+        auto array = vtkSmartPointer<Array>::New();
+        array->SetNumberOfComponents(int(components));
+        array->SetArray(ptr, components * tuples, 0, vtkAbstractArray::VTK_DATA_ARRAY_USER_DEFINED);
+        array->SetArrayFreeFunction(&releaseMapping);
+        return array;
+    }
+
+    // Maps the file, returns nullptr and sets error on failure
+    std::shared_ptr<Mapping> openMapping(std::string const& fileName, std::string& error)
+    {
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+        error = "Mapped meshes are little-endian, can't read " + fileName;
+        return {};
+#endif
+
+        auto mapping = std::make_shared<Mapping>();
+        mapping->file.setFileName(QString::fromStdString(fileName));
+        if (!mapping->file.open(QIODevice::ReadOnly)) {
+            error = "Can't open " + fileName + ": " + mapping->file.errorString().toStdString();
+            return {};
+        }
+
+        auto size = mapping->file.size();
+        if (quint64(size) < sizeof(MappedMeshHeader)) {
+            error = fileName + " is not a mapped mesh";
+            return {};
+        }
+
+        // Private, so VTK writing into an array (which it shouldn't) never makes it to the file
+        mapping->data = mapping->file.map(0, size, QFileDevice::MapPrivateOption);
+        if (!mapping->data) {
+            error = "Can't map " + fileName + ": " + mapping->file.errorString().toStdString();
+            return {};
+        }
+
+        return mapping;
+    }
+
+    // Whether the cells are well-formed: the offsets ascend from 0 to connectivitySize and every id is a point's.
+    // Reads every page of the cells, see checkMappedMesh().
+    template<class Id>
+    bool validCells(Mapping const& mapping, MappedMeshHeader const& header)
+    {
+        auto const* offsets = reinterpret_cast<Id const*>(mapping.data + header.offsets);
+        auto const* connectivity = reinterpret_cast<Id const*>(mapping.data + header.connectivity);
+
+        if (offsets[0] != 0)
+            return false;
+        for (quint64 i = 0; i < header.numberOfCells; ++i)
+            if (offsets[i + 1] < offsets[i])
+                return false;
+        if (quint64(offsets[header.numberOfCells]) != header.connectivitySize)
+            return false;
+
+        for (quint64 i = 0; i < header.connectivitySize; ++i)
+            if (connectivity[i] < 0 || quint64(connectivity[i]) >= header.numberOfPoints)
+                return false;
+        return true;
+    }
+
+    // Validates the mesh image at base (0 for .mvmesh files), returns false and sets error if there is none. The
+    // section offsets of header are made relative to the start of the file.
+    bool readHeader(Mapping const& mapping, quint64 base, MappedMeshHeader& header, std::string& error)
+    {
+        auto fileName = mapping.file.fileName().toStdString();
+        auto size = quint64(mapping.file.size());
+        if (base % 64 != 0 || base > size || size - base < sizeof(MappedMeshHeader)) {
+            error = fileName + " holds no mapped mesh at " + std::to_string(base);
+            return false;
+        }
+
+        std::memcpy(&header, mapping.data + base, sizeof(header));
+        if (std::memcmp(header.magic, s_magic, sizeof(s_magic)) != 0 || header.version != MappedMeshHeader::Version) {
+            error = fileName + " holds no version " + std::to_string(MappedMeshHeader::Version) + " mapped mesh at " + std::to_string(base);
+            return false;
+        }
+
+        // Whether count elements at offset are within the image, without computing their size (which may overflow)
+        const quint64 idSize = header.flags & MappedMeshHeader::LargeIds ? 8 : 4;
+        size -= base;
+        auto fits = [size](quint64 offset, quint64 count, quint64 elementSize, quint64 alignment) {
+            return offset % alignment == 0 && offset <= size && count <= (size - offset) / elementSize;
+        };
+        if (!fits(header.points, header.numberOfPoints, 3 * sizeof(float), sizeof(float))
+            || (header.normals && !fits(header.normals, header.numberOfPoints, 3 * sizeof(float), sizeof(float)))
+            || header.numberOfCells == std::numeric_limits<quint64>::max()
+            || !fits(header.offsets, header.numberOfCells + 1, idSize, idSize)
+            || !fits(header.connectivity, header.connectivitySize, idSize, idSize)) {
+            error = fileName + " is truncated or corrupt";
+            return false;
+        }
+
+        // Sections sharing bytes with each other (or the header) would alias arrays VTK takes as independent
+        const std::pair<quint64, quint64> sections[] = {
+            { 0, sizeof(MappedMeshHeader) },
+            { header.points, header.numberOfPoints * 3 * sizeof(float) },
+            { header.normals, header.normals ? header.numberOfPoints * 3 * sizeof(float) : 0 },
+            { header.offsets, (header.numberOfCells + 1) * idSize },
+            { header.connectivity, header.connectivitySize * idSize },
+        };
+        for (auto a = std::begin(sections); a != std::end(sections); ++a) {
+            for (auto b = a + 1; b != std::end(sections); ++b) {
+                if (a->second && b->second && a->first < b->first + b->second && b->first < a->first + a->second) {
+                    error = fileName + " has overlapping sections at " + std::to_string(base);
+                    return false;
+                }
+            }
+        }
+
+        header.points += base;
+        if (header.normals)
+            header.normals += base;
+        header.offsets += base;
+        header.connectivity += base;
+
+        // Just the ends of the offsets, checking every cell would read the whole file
+        auto offsetAt = [&mapping, &header, idSize](quint64 i) {
+            return idSize == 8 ? reinterpret_cast<vtkTypeInt64 const*>(mapping.data + header.offsets)[i]
+                               : reinterpret_cast<vtkTypeInt32 const*>(mapping.data + header.offsets)[i];
+        };
+        if (offsetAt(0) != 0 || quint64(offsetAt(header.numberOfCells)) != header.connectivitySize) {
+            error = fileName + " has corrupt cells at " + std::to_string(base);
+            return false;
+        }
+        return true;
+    }
+
+    // Maps the file and validates its header, returns nullptr and sets error on failure
+    std::shared_ptr<Mapping> openMapping(std::string const& fileName, MappedMeshHeader& header, std::string& error)
+    {
+        auto mapping = openMapping(fileName, error);
+        return mapping && readHeader(*mapping, 0, header, error) ? mapping : nullptr;
+    }
+
+    vtkSmartPointer<vtkPoints> mappedPoints(std::shared_ptr<Mapping> const& mapping, MappedMeshHeader const& header)
+    {
+        auto points = vtkSmartPointer<vtkPoints>::New();
+        points->SetData(wrap<vtkFloatArray>(mapping, header.points, 3, vtkIdType(header.numberOfPoints)));
+        return points;
+    }
+
+    vtkSmartPointer<vtkFloatArray> mappedNormals(std::shared_ptr<Mapping> const& mapping, MappedMeshHeader const& header)
+    {
+        if (!header.normals)
+            return nullptr;
+
+        auto normals = wrap<vtkFloatArray>(mapping, header.normals, 3, vtkIdType(header.numberOfPoints));
+        normals->SetName("Normals");
+        return normals;
+    }
+
+    vtkSmartPointer<vtkCellArray> mappedCells(std::shared_ptr<Mapping> const& mapping, MappedMeshHeader const& header)
+    {
+        auto cells = vtkSmartPointer<vtkCellArray>::New();
+        if (header.flags & MappedMeshHeader::LargeIds)
+            cells->SetData(
+                wrap<vtkTypeInt64Array>(mapping, header.offsets, 1, vtkIdType(header.numberOfCells + 1)),
+                wrap<vtkTypeInt64Array>(mapping, header.connectivity, 1, vtkIdType(header.connectivitySize)));
+        else
+            cells->SetData(
+                wrap<vtkTypeInt32Array>(mapping, header.offsets, 1, vtkIdType(header.numberOfCells + 1)),
+                wrap<vtkTypeInt32Array>(mapping, header.connectivity, 1, vtkIdType(header.connectivitySize)));
+        return cells;
+    }
+
+    // One vertex cell per point in [begin, end), for point clouds (files without cells)
+    vtkSmartPointer<vtkCellArray> vertices(quint64 begin, quint64 end)
+    {
+        vtkNew<vtkTypeInt64Array> offsets, connectivity;
+        offsets->SetNumberOfValues(vtkIdType(end - begin + 1));
+        connectivity->SetNumberOfValues(vtkIdType(end - begin));
+        for (quint64 i = 0; i < end - begin; ++i) {
+            offsets->SetValue(vtkIdType(i), vtkTypeInt64(i));
+            connectivity->SetValue(vtkIdType(i), vtkTypeInt64(begin + i));
+        }
+        offsets->SetValue(vtkIdType(end - begin), vtkTypeInt64(end - begin));
+
+        auto cells = vtkSmartPointer<vtkCellArray>::New();
+        cells->SetData(offsets, connectivity);
+        return cells;
+    }
+
+    void mappedPolyData(std::shared_ptr<Mapping> const& mapping, MappedMeshHeader const& header, vtkPolyData* output)
+    {
+        output->SetPoints(mappedPoints(mapping, header));
+        if (auto normals = mappedNormals(mapping, header))
+            output->GetPointData()->SetNormals(normals);
+
+        if (header.numberOfCells)
+            output->SetPolys(mappedCells(mapping, header));
+        else
+            output->SetVerts(vertices(0, header.numberOfPoints));
+    }
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+vtkStandardNewMacro(MappedMeshReader);
+
+MappedMeshReader::MappedMeshReader()
+{
+    SetNumberOfInputPorts(0);
+}
+
+void MappedMeshReader::SetFileName(std::string const& fileName)
+{
+    if (FileName != fileName) {
+        FileName = fileName;
+        Modified();
+    }
+}
+
+int MappedMeshReader::RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector* outputVector)
+{
+    auto* output = vtkPolyData::GetData(outputVector);
+
+    MappedMeshHeader header;
+    std::string error;
+    auto mapping = openMapping(FileName, header, error);
+    if (!mapping) {
+        vtkErrorMacro(<< error);
+        return 0;
+    }
+
+    mappedPolyData(mapping, header, output);
+    return 1;
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+struct MappedMeshStream::Private
+{
+    std::shared_ptr<Mapping> mapping;
+    MappedMeshHeader header = {};
+    QString error;
+
+    vtkSmartPointer<vtkPoints> points;
+    vtkSmartPointer<vtkFloatArray> normals;
+
+    quint64 items = 0;                  // cells, or points for point clouds
+    QVector<quint32> blocks;            // in streaming order
+    QVector<int> chunkEnd;              // index into blocks where each chunk ends
+
+    // The cells are checked here, as they are copied, rather than at open: cells whose offsets or ids are out of
+    // bounds are skipped.
+    template<class Id>
+    vtkSmartPointer<vtkCellArray> cells(int begin, int end) const
+    {
+        auto const* offsets = reinterpret_cast<Id const*>(mapping->data + header.offsets);
+        auto const* connectivity = reinterpret_cast<Id const*>(mapping->data + header.connectivity);
+
+        auto validOffsets = [offsets, this](quint64 cell) {
+            return offsets[cell] >= 0 && offsets[cell] <= offsets[cell + 1] && quint64(offsets[cell + 1]) <= header.connectivitySize;
+        };
+
+        quint64 cellCount = 0, idCount = 0;
+        for (int b = begin; b < end; ++b) {
+            auto first = quint64(blocks[b]) * BlockSize, last = qMin(first + BlockSize, items);
+            for (auto cell = first; cell < last; ++cell) {
+                if (validOffsets(cell)) {
+                    ++cellCount;
+                    idCount += quint64(offsets[cell + 1] - offsets[cell]);
+                }
+            }
+        }
+
+        vtkNew<vtkTypeInt64Array> o, c;
+        o->SetNumberOfValues(vtkIdType(cellCount + 1));
+        c->SetNumberOfValues(vtkIdType(idCount));
+        auto* op = o->GetPointer(0);
+        auto* cp = c->GetPointer(0);
+
+        vtkTypeInt64 at = 0;
+        quint64 skipped = 0;
+        for (int b = begin; b < end; ++b) {
+            auto first = quint64(blocks[b]) * BlockSize, last = qMin(first + BlockSize, items);
+            for (auto cell = first; cell < last; ++cell) {
+                bool valid = validOffsets(cell);
+                for (auto i = offsets[cell]; valid && i < offsets[cell + 1]; ++i)
+                    valid = connectivity[i] >= 0 && quint64(connectivity[i]) < header.numberOfPoints;
+                if (!valid) {
+                    ++skipped;
+                    continue;
+                }
+
+                *op++ = at;
+                for (auto i = offsets[cell]; i < offsets[cell + 1]; ++i, ++at)
+                    *cp++ = connectivity[i];
+            }
+        }
+        *op = at;
+
+        if (skipped) {
+            qWarning() << Q_FUNC_INFO << "YIKES!! Skipped" << skipped << "corrupt cells of" << mapping->file.fileName();
+            o->SetNumberOfValues(vtkIdType(op - o->GetPointer(0)) + 1);
+            c->SetNumberOfValues(vtkIdType(at));
+        }
+
+        auto result = vtkSmartPointer<vtkCellArray>::New();
+        result->SetData(o, c);
+        return result;
+    }
+};
+
+MappedMeshStream::MappedMeshStream(QString const& fileName) : d(new Private)
+{
+    std::string error;
+    d->mapping = openMapping(fileName.toStdString(), d->header, error);
+    if (!d->mapping) {
+        d->error = QString::fromStdString(error);
+        return;
+    }
+
+    d->points = mappedPoints(d->mapping, d->header);
+    d->normals = mappedNormals(d->mapping, d->header);
+    d->items = d->header.numberOfCells ? d->header.numberOfCells : d->header.numberOfPoints;
+
+    // Blocks in bit-reversed order: every prefix of the order is spread evenly over the file
+    quint32 count = quint32((d->items + BlockSize - 1) / BlockSize);
+    int bits = 0;
+    while ((quint64(1) << bits) < count)
+        ++bits;
+    d->blocks.reserve(count);
+    for (quint32 i = 0; i < (quint32(1) << bits); ++i) {
+        quint32 r = 0;
+        for (int b = 0; b < bits; ++b)
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        if (r < count)
+            d->blocks << r;
+    }
+
+    // The first chunk is small enough to show up right away, every further one doubles what's been read
+    for (int end = qMin(int(count), int(FirstChunkBlocks)); ; end = qMin(int(count), end * 2)) {
+        d->chunkEnd << end;
+        if (end >= int(count))
+            break;
+    }
+}
+
+MappedMeshStream::~MappedMeshStream() = default;
+
+bool MappedMeshStream::isValid() const
+{
+    return bool(d->mapping);
+}
+
+QString MappedMeshStream::errorString() const
+{
+    return d->error;
+}
+
+bool MappedMeshStream::isPointCloud() const
+{
+    return !d->header.numberOfCells;
+}
+
+vtkPoints* MappedMeshStream::points() const
+{
+    return d->points;
+}
+
+vtkDataArray* MappedMeshStream::normals() const
+{
+    return d->normals;
+}
+
+int MappedMeshStream::numberOfChunks() const
+{
+    return isValid() ? int(d->chunkEnd.size()) : 0;
+}
+
+double MappedMeshStream::progress(int chunk) const
+{
+    if (!isValid() || chunk < 0)
+        return 0;
+    if (chunk >= numberOfChunks() - 1)
+        return 1;
+    return double(d->chunkEnd[chunk]) * BlockSize / qMax<quint64>(1, d->items);
+}
+
+vtkSmartPointer<vtkCellArray> MappedMeshStream::chunk(int index) const
+{
+    if (index < 0 || index >= numberOfChunks())
+        return nullptr;
+
+    int begin = index ? d->chunkEnd[index - 1] : 0, end = d->chunkEnd[index];
+
+    if (isPointCloud()) {
+        // Point ids of the blocks, as vertices
+        auto cells = vtkSmartPointer<vtkCellArray>::New();
+        for (int b = begin; b < end; ++b) {
+            auto first = quint64(d->blocks[b]) * BlockSize;
+            cells->Append(vertices(first, qMin(first + BlockSize, d->items)));
+        }
+        return cells;
+    }
+
+    return d->header.flags & MappedMeshHeader::LargeIds
+        ? d->cells<vtkTypeInt64>(begin, end)
+        : d->cells<vtkTypeInt32>(begin, end);
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+bool writeMappedMesh(vtkPolyData* polyData, QIODevice& device, QString* error)
+{
+    auto fail = [error](QString const& message) {
+        if (error)
+            *error = message;
+        return false;
+    };
+
+    if (!polyData || !polyData->GetPoints())
+        return fail("Nothing to write");
+    if (polyData->GetNumberOfVerts() || polyData->GetNumberOfLines() || polyData->GetNumberOfStrips())
+        return fail("Only polygons can be written, triangulate first");
+
+    const quint64 numberOfPoints = quint64(polyData->GetNumberOfPoints());
+    const bool largeIds = numberOfPoints > quint64(std::numeric_limits<qint32>::max())
+        || quint64(polyData->GetPolys()->GetNumberOfConnectivityIds()) > quint64(std::numeric_limits<qint32>::max());
+
+    // Convert everything to the file's types up front, VTK's DeepCopy converts between array types
+    vtkNew<vtkFloatArray> points;
+    points->DeepCopy(polyData->GetPoints()->GetData());
+
+    vtkSmartPointer<vtkFloatArray> normals;
+    if (auto* n = polyData->GetPointData()->GetNormals()) {
+        normals = vtkSmartPointer<vtkFloatArray>::New();
+        normals->DeepCopy(n);
+    }
+
+    vtkSmartPointer<vtkDataArray> offsets, connectivity;
+    if (largeIds) {
+        offsets = vtkSmartPointer<vtkTypeInt64Array>::New();
+        connectivity = vtkSmartPointer<vtkTypeInt64Array>::New();
+    } else {
+        offsets = vtkSmartPointer<vtkTypeInt32Array>::New();
+        connectivity = vtkSmartPointer<vtkTypeInt32Array>::New();
+    }
+    offsets->DeepCopy(polyData->GetPolys()->GetOffsetsArray());
+    connectivity->DeepCopy(polyData->GetPolys()->GetConnectivityArray());
+
+    MappedMeshHeader header = {};
+    std::memcpy(header.magic, s_magic, sizeof(s_magic));
+    header.version = MappedMeshHeader::Version;
+    header.flags = largeIds ? MappedMeshHeader::LargeIds : 0;
+    header.numberOfPoints = numberOfPoints;
+    header.numberOfCells = quint64(polyData->GetNumberOfPolys());
+    header.connectivitySize = quint64(connectivity->GetNumberOfValues());
+    polyData->GetBounds(header.bounds);
+
+    // Lay the sections out, 64 byte aligned
+    auto bytes = [](vtkDataArray* a) { return quint64(a->GetNumberOfValues()) * quint64(a->GetDataTypeSize()); };
+    auto align = [](quint64 x) { return (x + 63) / 64 * 64; };
+    quint64 end = align(sizeof(header));
+    header.points = end;        end = align(end + bytes(points));
+    if (normals) {
+        header.normals = end;   end = align(end + bytes(normals));
+    }
+    header.offsets = end;       end = align(end + bytes(offsets));
+    header.connectivity = end;
+
+    const quint64 base = quint64(device.pos());
+    if (base % 64 != 0)
+        return fail("Mapped meshes start 64 byte aligned");
+
+    auto write = [&device, base](quint64 at, void const* data, quint64 size) {
+        static const char zeros[64] = {};
+        if (quint64 pos = quint64(device.pos()) - base; pos < at && device.write(zeros, qint64(at - pos)) != qint64(at - pos))
+            return false;
+        return device.write(static_cast<const char*>(data), qint64(size)) == qint64(size);
+    };
+    bool ok = write(0, &header, sizeof(header))
+        && write(header.points, points->GetVoidPointer(0), bytes(points))
+        && (!normals || write(header.normals, normals->GetVoidPointer(0), bytes(normals)))
+        && write(header.offsets, offsets->GetVoidPointer(0), bytes(offsets))
+        && write(header.connectivity, connectivity->GetVoidPointer(0), bytes(connectivity));
+
+    if (!ok)
+        return fail(device.errorString());
+    return true;
+}
+
+bool writeMappedMesh(vtkPolyData* polyData, QString const& fileName, QString* error)
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+
+    if (!writeMappedMesh(polyData, file, error)) {
+        file.cancelWriting();
+        return false;
+    }
+    if (!file.commit()) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool checkMappedMesh(QString const& fileName, QString* error)
+{
+    MappedMeshHeader header;
+    std::string message;
+    if (auto mapping = openMapping(fileName.toStdString(), header, message)) {
+        if (!(header.flags & MappedMeshHeader::LargeIds ? validCells<vtkTypeInt64>(*mapping, header) : validCells<vtkTypeInt32>(*mapping, header)))
+            message = fileName.toStdString() + " has corrupt cells";
+    }
+
+    if (message.empty())
+        return true;
+    if (error)
+        *error = QString::fromStdString(message);
+    return false;
+}
+
+QVector<vtkSmartPointer<vtkPolyData>> readMappedMeshes(QString const& fileName, QVector<quint64> const& offsets, QString* error)
+{
+    QVector<vtkSmartPointer<vtkPolyData>> meshes(offsets.size());
+
+    std::string message;
+    auto mapping = openMapping(fileName.toStdString(), message);
+    for (int i = 0; mapping && i < offsets.size(); ++i) {
+        MappedMeshHeader header;
+        std::string invalid;
+        if (!readHeader(*mapping, offsets[i], header, invalid)) {
+            if (message.empty())
+                message = invalid;
+            continue;
+        }
+
+        meshes[i] = vtkSmartPointer<vtkPolyData>::New();
+        mappedPolyData(mapping, header, meshes[i]);
+    }
+
+    if (error && !message.empty())
+        *error = QString::fromStdString(message);
+    return meshes;
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+static QMutex s_filesMutex;
+static QHash<QString, QString> s_files;
+
+QString mappedMeshFile(QString const& source)
+{
+    QMutexLocker lock(&s_filesMutex);
+    return s_files.value(source);
+}
+
+QStringList registerMappedMeshes(QString const& directory)
+{
+    QStringList names;
+
+    QDir dir(directory);
+    for (auto const& info : dir.entryInfoList({ "*.mvmesh" }, QDir::Files | QDir::Readable, QDir::Name)) {
+        auto path = info.absoluteFilePath().toStdString();
+        GeometryCache::instance().registerSource(info.fileName(), [path](QVector<double> const&) -> vtkSmartPointer<vtkPolyDataAlgorithm> {
+            auto reader = vtkSmartPointer<MappedMeshReader>::New();
+            reader->SetFileName(path);
+            return reader;
+        });
+        names << info.fileName();
+
+        QMutexLocker lock(&s_filesMutex);
+        s_files.insert(info.fileName(), info.absoluteFilePath());
+    }
+
+    return names;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <QtCore/QScopedPointer>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QtCore/QtGlobal>
+
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkSmartPointer.h>
+
+#include <string>
+
+class QIODevice;
+class vtkCellArray;
+class vtkDataArray;
+class vtkPoints;
+class vtkPolyData;
+
+/**
+* The .mvmesh file format: a compact binary triangle mesh laid out exactly like VTK keeps it in memory, so it can be
+* memory-mapped and handed to VTK without parsing or copying.
+*
+*   MappedMeshHeader (128 bytes)
+*   points:       numberOfPoints * 3 float32
+*   normals:      numberOfPoints * 3 float32 (optional)
+*   offsets:      (numberOfCells + 1) int32 or int64, see LargeIds
+*   connectivity: connectivitySize int32 or int64
+*
+* Sections start at the byte offsets given in the header (64 byte aligned), all values are little-endian.
+* Use tools/MeshConvert to create .mvmesh files from VTP, STL and PLY files.
+*
+* The same image may be embedded in other files at a 64 byte aligned offset, e.g. in session snapshots (see
+* Session), see readMappedMeshes().
+*/
+struct MappedMeshHeader
+{
+    enum { Version = 1 };
+    enum Flags : quint32 { LargeIds = 1 };
+
+    char magic[8];              // "MVMESH\0\0"
+    quint32 version;
+    quint32 flags;
+    quint64 numberOfPoints;
+    quint64 numberOfCells;
+    quint64 connectivitySize;
+    quint64 points;             // section offsets in bytes from the start of the header, normals is 0 if absent
+    quint64 normals;
+    quint64 offsets;
+    quint64 connectivity;
+    double bounds[6];
+    char reserved[8];
+};
+static_assert(sizeof(MappedMeshHeader) == 128, "MappedMeshHeader must be 128 bytes");
+
+/**
+* Reads an .mvmesh file into polygons.
+*
+* The file is mapped into memory and the points, normals and cell arrays of the output point straight into the
+* mapping (copy-on-write). The mapping is released together with the last of these arrays, i.e. it lives as long as
+* any vtkPolyData shares them, whether or not the reader is still around.
+*
+* \note Only the header and the sizes of the sections are checked, checking every cell would read the whole file.
+*       Files from elsewhere should be checked with checkMappedMesh() first, e.g. with MeshConvert --check.
+*/
+class MappedMeshReader : public vtkPolyDataAlgorithm
+{
+public:
+    static MappedMeshReader* New();
+    vtkTypeMacro(MappedMeshReader, vtkPolyDataAlgorithm);
+
+    void SetFileName(std::string const& fileName);
+    std::string const& GetFileName() const { return FileName; }
+
+protected:
+    MappedMeshReader();
+    int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+
+private:
+    std::string FileName;
+};
+
+/**
+* Reads an .mvmesh file progressively, coarse to fine, for views to show something right away and refine while
+* the rest is read.
+*
+* The cells (the points of a point cloud) are read in blocks of BlockSize consecutive cells, converted meshes keep
+* the cell order of their source, which is usually spatially coherent. The blocks are visited in bit-reversed
+* order, so every chunk is spread evenly over the whole mesh and touches only the pages of the file it needs.
+* chunk(0) has FirstChunkBlocks blocks, every further chunk about doubles what's been read. Together the chunks
+* are the whole mesh.
+*
+* \note points() and normals() are zero-copy (see MappedMeshReader), the chunks' cells are copies. Those are
+*       checked while copied, cells with offsets or point ids out of bounds are skipped.
+*
+* \note chunk() is thread safe and meant to be called from worker threads.
+*/
+class MappedMeshStream
+{
+public:
+    enum { BlockSize = 1024, FirstChunkBlocks = 64 };
+
+    explicit MappedMeshStream(QString const& fileName);
+    ~MappedMeshStream();
+
+    bool isValid() const;
+    QString errorString() const;
+
+    bool isPointCloud() const;
+    vtkPoints* points() const;
+    vtkDataArray* normals() const;
+
+    int numberOfChunks() const;
+
+    // The part of the mesh read once chunk has been read, in [0, 1]
+    double progress(int chunk) const;
+
+    // Polygons, or vertices for point clouds
+    vtkSmartPointer<vtkCellArray> chunk(int index) const;
+
+private:
+    Q_DISABLE_COPY(MappedMeshStream)
+    struct Private;
+    QScopedPointer<Private> d;
+};
+
+/**
+* Writes the polygons of polyData (which must be triangulated, see vtkTriangleFilter) with their point normals,
+* if any, as an .mvmesh file. Returns false and sets error on failure.
+*/
+bool writeMappedMesh(vtkPolyData* polyData, QString const& fileName, QString* error = nullptr);
+
+/**
+* Like above but writes the image at the current position of device, which must be 64 byte aligned.
+*/
+bool writeMappedMesh(vtkPolyData* polyData, QIODevice& device, QString* error = nullptr);
+
+/**
+* Checks every cell of an .mvmesh file: its offsets ascend from 0 to the size of the connectivity and every point id
+* is one of its points. Unlike opening the file this reads all of it. Returns false and sets error on failure.
+*/
+bool checkMappedMesh(QString const& fileName, QString* error = nullptr);
+
+/**
+* Reads the images embedded in fileName at offsets, zero-copy like MappedMeshReader: the file is mapped once and
+* the mapping is shared by all of them. The meshes at offsets which don't hold a valid image are nullptr, error is
+* set to the first problem.
+*/
+QVector<vtkSmartPointer<vtkPolyData>> readMappedMeshes(QString const& fileName, QVector<quint64> const& offsets, QString* error = nullptr);
+
+/**
+* Registers every .mvmesh file of directory as a GeometryCache source named after the file, e.g. "turbine.mvmesh".
+* Returns the names of the registered sources.
+*/
+QStringList registerMappedMeshes(QString const& directory);
+
+/**
+* The path of the .mvmesh file behind a source registered by registerMappedMeshes(), or an empty string.
+*/
+QString mappedMeshFile(QString const& source);
@@ -1,25 +1,328 @@
 #include "MyVtkItem.h"
+#include "QQuickVtkTrace.h"
 
+#include <QtCore/QCoreApplication>
+#include <QtCore/QHash>
+#include <QtCore/QMetaMethod>
+#include <QtCore/QMutex>
+#include <QtCore/QPointer>
+#include <QtCore/QThreadPool>
+#include <QtQuick/QQuickWindow>
+
+#include <vtkCommand.h>
 #include <vtkInteractorStyleTrackballCamera.h>
+#include <vtkMath.h>
+#include <vtkCellArray.h>
+#include <vtkAbstractCellLocator.h>
+#include <vtkBoundingBox.h>
+#include <vtkGenericCell.h>
+#include <vtkIdList.h>
+#include <vtkLine.h>
+#include <vtkOpenGLRenderWindow.h>
+#include <vtkOpenGLState.h>
+#include <vtkPointData.h>
+#include <vtkPolyData.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+// How many of the steps coming up a playing time series keeps prefetched, budget permitting
+static const int s_prefetchSteps = 32;
+
+// How far from the point, in pixels, BufferPick looks for something, so single points and thin lines are hit
+static const int s_pickTolerance = 2;
+
+namespace
+{
+    // The ray from the near to the far clipping plane through a point on the screen
+    struct Ray
+    {
+        double from[3];
+        double to[3];
+    };
+
+    // Reads the cell of polyData with id cellId from its cell arrays: unlike GetCell() this doesn't build (or race
+    // with whoever builds) polyData's cell map. Returns false if there is no such cell.
+    bool readCell(vtkPolyData* polyData, vtkIdType cellId, vtkGenericCell* cell)
+    {
+        vtkCellArray* arrays[] = { polyData->GetVerts(), polyData->GetLines(), polyData->GetPolys(), polyData->GetStrips() };
+        const int types[] = { VTK_POLY_VERTEX, VTK_POLY_LINE, VTK_POLYGON, VTK_TRIANGLE_STRIP };
+        for (int i = 0; i < 4; ++i) {
+            auto cells = arrays[i] ? arrays[i]->GetNumberOfCells() : 0;
+            if (cellId < 0 || cellId >= cells) {
+                cellId -= cells;
+                continue;
+            }
+
+            cell->SetCellType(types[i]);
+            arrays[i]->GetCellAtId(cellId, cell->PointIds);
+            polyData->GetPoints()->GetPoints(cell->PointIds, cell->Points);
+            return true;
+        }
+        return false;
+    }
+
+    // The result of a hit of cell, in the model's coordinates: the hit point is the ray's intersection with the cell
+    // (or its point closest to the ray, if the ray only passes close by), the point is the cell's point closest to it
+    MyVtkItem::PickResult hit(vtkGenericCell* cell, vtkIdType cellId, Ray const& ray, vtkMatrix4x4* transform)
+    {
+        MyVtkItem::PickResult result;
+        result.cellId = cellId;
+
+        double closest = VTK_DOUBLE_MAX;
+        double position[3] = {};
+        for (vtkIdType i = 0; i < cell->GetNumberOfPoints(); ++i) {
+            double p[3];
+            cell->Points->GetPoint(i, p);
+            if (double d = vtkLine::DistanceToLine(p, ray.from, ray.to); d < closest) {
+                closest = d;
+                result.pointId = cell->PointIds->GetId(i);
+                std::copy_n(p, 3, position);
+            }
+        }
+
+        double t, x[3], pcoords[3];
+        int subId;
+        if (cell->IntersectWithLine(ray.from, ray.to, 0, t, x, pcoords, subId))
+            std::copy_n(x, 3, position);
+
+        double model[4] = { position[0], position[1], position[2], 1 }, world[4];
+        transform->MultiplyPoint(model, world);
+        result.position = QVector3D(float(world[0] / world[3]), float(world[1] / world[3]), float(world[2] / world[3]));
+        return result;
+    }
+}
 
+vtkStandardNewMacro(MyVtkItem::CameraLink);
+vtkStandardNewMacro(MyVtkItem::Pipeline);
 vtkStandardNewMacro(MyVtkItem::Data);
 
+vtkSmartPointer<MyVtkItem::CameraLink> MyVtkItem::CameraLink::acquire(QQuickWindow* window, QString const& name, vtkCamera* seed)
+{
+    // Per window, since every window renders on its own thread
+    static QMutex mutex;
+    static QHash<QPair<QQuickWindow*, QString>, vtkWeakPointer<CameraLink>> links;
+
+    QMutexLocker lock(&mutex);
+
+    for (auto it = links.begin(); it != links.end();)
+        it = it.value() ? std::next(it) : links.erase(it);
+
+    vtkSmartPointer<CameraLink> link = links.value({ window, name }).Get();
+    if (!link) {
+        link = vtkSmartPointer<CameraLink>::New();
+        link->camera->DeepCopy(seed);
+        links.insert({ window, name }, link.Get());
+    }
+    return link;
+}
+
+void MyVtkItem::CameraLink::resetCamera()
+{
+    renderers.removeIf([](vtkWeakPointer<vtkRenderer> const& r) { return !r; });
+
+    // The narrowest member decides how far back the camera has to be
+    vtkBoundingBox box;
+    double aspect = 1;
+    for (auto const& renderer : std::as_const(renderers)) {
+        double b[6];
+        renderer->ComputeVisiblePropBounds(b);
+        if (!vtkMath::AreBoundsInitialized(b))
+            continue;
+        box.AddBounds(b);
+
+        double a[2];
+        renderer->ComputeAspect();
+        renderer->GetAspect(a);
+        if (a[1] > 0)
+            aspect = qMin(aspect, a[0] / a[1]);
+    }
+    if (!box.IsValid())
+        return;
+
+    // Like vtkRenderer::ResetCamera(), for the link's camera rather than a member's
+    double center[3];
+    box.GetCenter(center);
+    double radius = box.GetDiagonalLength() / 2;
+    if (radius <= 0)
+        radius = 0.5;
+
+    double halfAngle = vtkMath::RadiansFromDegrees(camera->GetViewAngle()) / 2;
+    if (aspect < 1)
+        halfAngle = std::atan(std::tan(halfAngle) * aspect);
+    double distance = radius / std::sin(halfAngle);
+
+    double normal[3];
+    camera->GetViewPlaneNormal(normal);
+    double viewUp[3];
+    camera->GetViewUp(viewUp);
+    if (std::abs(vtkMath::Dot(viewUp, normal)) > 0.999)
+        camera->SetViewUp(-viewUp[2], viewUp[0], viewUp[1]);
+
+    camera->SetFocalPoint(center);
+    camera->SetPosition(center[0] + distance * normal[0], center[1] + distance * normal[1], center[2] + distance * normal[2]);
+    camera->SetParallelScale(aspect < 1 ? radius / aspect : radius);
+    camera->SetClippingRange(qMax(distance - 1.01 * radius, 0.001 * distance), distance + 1.01 * radius);
+}
+
+MyVtkItem::Data::~Data()
+{
+    join(nullptr);
+
+    for (auto const& pick : std::as_const(pendingPicks))
+        pick.done({});
+}
+
+void MyVtkItem::Data::join(CameraLink* to)
+{
+    if (link == to)
+        return;
+    if (link)
+        link->renderers.removeAll(renderer.Get());
+    link = to;
+    if (link)
+        link->renderers.append(renderer.Get());
+}
+
+void MyVtkItem::Pipeline::renderStarted()
+{
+    if (link)
+        link->resetDone = false;
+}
+
+void MyVtkItem::Data::selectNodes()
+{
+    if (!cloud || !selection.update(cloud, renderer, pointBudget))
+        return;
+
+    auto const& nodes = selection.polyData();
+    cloudBlocks->SetNumberOfBlocks(unsigned(nodes.size()));
+    for (int i = 0; i < nodes.size(); ++i)
+        cloudBlocks->SetBlock(unsigned(i), nodes[i]);
+    cloudBlocks->Modified();
+}
+
+void MyVtkItem::Data::show(Pipeline* pipeline)
+{
+    if (cloud != pipeline->cloud) {
+        cloud = pipeline->cloud;
+        selection = {};
+        cloudBlocks->SetNumberOfBlocks(0);
+        cloudBlocks->Modified();
+    }
+
+    // A point cloud is its own level of detail, see PointCloudSelection
+    if (cloud) {
+        mapper->SetInputData(nullptr);
+        lodMapper->SetInputData(nullptr);
+        glyphMapper->SetInputData(nullptr);
+        actor->SetMapper(cloudMapper);
+        return;
+    }
+
+    // The shape is small, it has no level of detail. Only what the instances have is used.
+    if (pipeline->instanced) {
+        mapper->SetInputData(nullptr);
+        lodMapper->SetInputData(nullptr);
+        glyphMapper->SetSourceData(pipeline->geometry.polyData());
+        glyphMapper->SetInputData(pipeline->glyphPoints);
+        glyphMapper->SetScalarVisibility(!pipeline->glyphs.colors.isEmpty());
+        glyphMapper->SetScaling(!pipeline->glyphs.scales.isEmpty());
+        glyphMapper->SetOrient(!pipeline->glyphs.orientations.isEmpty());
+        actor->SetMapper(glyphMapper);
+        return;
+    }
+
+    glyphMapper->SetInputData(nullptr);
+
+    mapper->SetInputData(pipeline->streamed ? pipeline->streamed.Get() : pipeline->geometry.polyData());
+    lodMapper->SetInputData(pipeline->lod);
+    actor->SetMapper(useLod && pipeline->lod ? lodMapper.Get() : mapper.Get());
+}
+
+vtkMTimeType MyVtkItem::Data::sceneTime() const
+{
+    auto time = std::max({ renderer->GetMTime(), renderer->GetActiveCamera()->GetMTime(), actor->GetMTime(), cloudBlocks->GetMTime() });
+    if (auto* matrix = actor->GetUserMatrix())
+        time = std::max(time, matrix->GetMTime());
+    if (auto* mapper = actor->GetMapper()) {
+        time = std::max(time, mapper->GetMTime());
+        if (auto* input = mapper->GetInputDataObject(0, 0))
+            time = std::max(time, input->GetMTime());
+    }
+    return time;
+}
+
 MyVtkItem::MyVtkItem()
 {
     connect(this, &QQuickItem::widthChanged, this, &MyVtkItem::resetCamera);
     connect(this, &QQuickItem::heightChanged, this, &MyVtkItem::resetCamera);
+
+    // Trading quality for speed is up to adaptiveQuality, without it the full geometry is rendered throughout
+    auto updateLod = [this] {
+        dispatch_async([this, useLod = interacting() && adaptiveQuality()](vtkRenderWindow* renderWindow, vtkUserData userData) {
+            auto* vtk = Data::SafeDownCast(userData);
+            vtk->useLod = useLod;
+            vtk->show(Pipeline::SafeDownCast(pipeline()));
+        });
+    };
+    connect(this, &QQuickVtkItem::interactingChanged, this, updateLod);
+    connect(this, &QQuickVtkItem::interactingChanged, this, [this](bool interacting) {
+        if (!interacting && _hoverPicking && _pickMode == BufferPick)
+            hoverPick(_hoverPoint);
+    });
+    connect(this, &QQuickVtkItem::adaptiveQualityChanged, this, updateLod);
+
+    // The nodes a pane asked for show up in its next frame
+    connect(&PointCloudCache::instance(), &PointCloudCache::nodeLoaded, this, [this] {
+        if (_cloud)
+            scheduleRender();
+    });
+
+    connect(&TimeSeriesCache::instance(), &TimeSeriesCache::stepReady, this, &MyVtkItem::stepReady);
+    _playTimer.setTimerType(Qt::PreciseTimer);
+    connect(&_playTimer, &QTimer::timeout, this, &MyVtkItem::advance);
 }
 
 QString MyVtkItem::source() const {
     return _source;
 }
 
+QQuickVtkItem::vtkUserData MyVtkItem::initializePipeline()
+{
+    return vtkSmartPointer<Pipeline>::New();
+}
+
 QQuickVtkItem::vtkUserData MyVtkItem::initializeVTK(vtkRenderWindow* renderWindow)
 {
     vtkNew<Data> vtk;
 
+    auto* pipeline = Pipeline::SafeDownCast(this->pipeline());
+
     vtk->actor->SetMapper(vtk->mapper);
 
+    // Plain points, colored by the cloud's colors if it has some
+    vtk->cloudMapper->SetInputDataObject(vtk->cloudBlocks);
+    vtk->cloudMapper->SetScaleFactor(0);
+    vtk->cloudMapper->SetColorModeToDirectScalars();
+    vtk->cloudMapper->SetScalarModeToUsePointData();
+    vtk->pointBudget = _pointBudget;
+    vtk->renderer->AddObserver(vtkCommand::StartEvent, vtk.Get(), &Data::selectNodes);
+
+    // One instanced draw of the shape, see GlyphInstances::apply() for the arrays
+    vtk->glyphMapper->SetScaleArray("scale");
+    vtk->glyphMapper->SetScaleModeToScaleByMagnitude();
+    vtk->glyphMapper->SetOrientationArray("orientation");
+    vtk->glyphMapper->SetOrientationModeToQuaternion();
+    vtk->glyphMapper->SetScalarModeToUsePointFieldData();
+    vtk->glyphMapper->SelectColorArray("color");
+    vtk->glyphMapper->SetColorModeToDirectScalars();
+
+    vtk->renderer->SetActiveCamera(pipeline->activeCamera());
+    vtk->renderer->AddObserver(vtkCommand::StartEvent, pipeline, &Pipeline::renderStarted);
+    vtk->join(pipeline->link);
+    vtk->actor->SetUserMatrix(pipeline->transform);
     vtk->renderer->AddActor(vtk->actor);
     vtk->renderer->SetBackground(0.5, 0.5, 0.7);
     vtk->renderer->SetBackground2(0.7, 0.7, 0.7);
@@ -52,49 +355,998 @@ QQuickVtkItem::vtkUserData MyVtkItem::initializeVTK(vtkRenderWindow* renderWindo
     //
     // Notice that there are 2 (two) 'destructed' messages but you only unsplit once!!
     // QML deleted both "small" QSGNodes and then created a new QSGNode to fill the empty column.
-    setSource(_source, true);
-
-    // Note:  It is okay to store some non-graphical VTK objects in the QQuickVTKItem instead of the
-    // vtkUserData but ONLY if they are accessed from the qml-render-thread. (i.e. only in the
-    // initializeVTK, destroyingVTK or dispatch_async methods)
-    vtk->renderer->GetActiveCamera()->DeepCopy(_camera);
+    //
+    // Note: Our sources, their computed output and the camera live in the Pipeline (see initializePipeline) which
+    // survives the QSGNode, so re-synchronizing here only hooks the existing data up to the new mappers. A source
+    // still being computed is swapped in by setGeometry() once it's ready.
+    vtk->show(pipeline);
 
     return vtk;
 }
 
-void MyVtkItem::destroyingVTK(vtkRenderWindow* renderWindow, vtkUserData userData)
+void MyVtkItem::resetCamera()
+{
+    // A restored camera stays until the geometry it was saved with is back, see restoreCamera()
+    if (_keepCamera)
+        return;
+
+    dispatch_async([this](vtkRenderWindow* renderWindow, vtkUserData userData) {
+        auto* vtk = Data::SafeDownCast(userData);
+        auto* pipeline = Pipeline::SafeDownCast(this->pipeline());
+
+        // A linked camera is reset once per frame, to frame what all panes of the group show
+        if (auto* link = pipeline->link.Get()) {
+            if (!link->resetDone) {
+                link->resetDone = true;
+                link->resetCamera();
+            }
+        } else if (pipeline->cloud) {
+            // Only what's loaded has bounds, frame all of the cloud
+            double bounds[6];
+            std::copy(std::begin(pipeline->cloud->header().bounds), std::end(pipeline->cloud->header().bounds), bounds);
+            vtk->renderer->ResetCamera(bounds);
+        } else
+            vtk->renderer->ResetCamera();
+
+        scheduleRender();
+        });
+}
+
+QString MyVtkItem::linkGroup() const
 {
-    auto* vtk = Data::SafeDownCast(userData);
-    _camera->DeepCopy(vtk->renderer->GetActiveCamera());
+    return _linkGroup;
 }
 
-void MyVtkItem::resetCamera()
+void MyVtkItem::setLinkGroup(QString v)
 {
+    if (_linkGroup == v)
+        return;
+
+    emit linkGroupChanged(_linkGroup = v);
+    setRenderGroup(v.isEmpty() ? QString() : "MyVtkItem.linkGroup:" + v);
+
     dispatch_async([this](vtkRenderWindow* renderWindow, vtkUserData userData) {
-        auto* vtk = Data::SafeDownCast(userData);
-        vtk->renderer->ResetCamera();
+        link(Data::SafeDownCast(userData), Pipeline::SafeDownCast(this->pipeline()));
+        });
+}
+
+void MyVtkItem::link(Data* vtk, Pipeline* pipeline)
+{
+    if (pipeline->linkGroup == _linkGroup)
+        return;
+
+    // Keep looking at the same thing, whether joining or leaving a group: a new group starts off with our camera,
+    // and we leave with the group's camera.
+    vtkCamera* previous = pipeline->activeCamera();
+    if (_linkGroup.isEmpty())
+        pipeline->camera->DeepCopy(previous);
+
+    pipeline->linkGroup = _linkGroup;
+    pipeline->link = _linkGroup.isEmpty() ? nullptr : CameraLink::acquire(window(), _linkGroup, previous);
+    vtk->join(pipeline->link);
+
+    vtk->renderer->SetActiveCamera(pipeline->activeCamera());
+    scheduleRender();
+}
+
+QMatrix4x4 MyVtkItem::linkTransform() const
+{
+    return _linkTransform;
+}
+
+void MyVtkItem::setLinkTransform(QMatrix4x4 v)
+{
+    if (_linkTransform == v)
+        return;
+
+    emit linkTransformChanged(_linkTransform = v);
+
+    dispatch_async([this, v](vtkRenderWindow* renderWindow, vtkUserData userData) {
+        auto* pipeline = Pipeline::SafeDownCast(this->pipeline());
+        for (int row = 0; row < 4; ++row)
+            for (int column = 0; column < 4; ++column)
+                pipeline->transform->SetElement(row, column, v(row, column));
         scheduleRender();
         });
 }
 
+MyVtkItem::Status MyVtkItem::status() const
+{
+    return _status;
+}
+
+double MyVtkItem::progress() const
+{
+    return _progress;
+}
+
 void MyVtkItem::setSource(QString v, bool forceVtk)
 {
     if (_source != v)
         emit sourceChanged((forceVtk = true, _source = v));
 
-    if (forceVtk)
-        dispatch_async([this](vtkRenderWindow* renderWindow, vtkUserData userData) {
+    if (!forceVtk)
+        return;
+
+    // Stop streaming the previous source
+    if (_streamCancel)
+        *_streamCancel = true;
+    _streamCancel.reset();
+
+    auto cloudFile = pointCloudFile(_source);
+    if (!GeometryCache::instance().contains(_source) && cloudFile.isEmpty() && glyphShape(_source).isEmpty()) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! Unknown source:'" << _source << "'";
+        emit statusChanged(_status = Error);
+        _playTimer.stop();
+        return;
+    }
+
+    emit statusChanged(_status = Loading);
+    emit progressChanged(_progress = 0);
+
+    if (auto times = timeSeriesTimes(_source); _times != times)
+        emit timesChanged(_times = times);
+    _step = _shownStep = -1;
+
+    if (!cloudFile.isEmpty())
+        openCloud(cloudFile);
+    else if (!_times.isEmpty())
+        seek(int(std::upper_bound(_times.cbegin(), _times.cend(), _currentTime) - _times.cbegin()) - 1);
+    else if (auto file = mappedMeshFile(_source); _streaming && !file.isEmpty() && !GeometryCache::instance().find({ _source, {} }))
+        stream(file);
+    else
+        acquire();
+
+    updatePlayback();
+}
+
+void MyVtkItem::acquire()
+{
+    // Execute the source (for glyph sources: their shape) on a worker thread, the render thread only ever sees the
+    // computed snapshot
+    auto shape = glyphShape(_source);
+    GeometryCache::instance().acquireAsync({ shape.isEmpty() ? _source : shape, {} }, this,
+        [this, source = _source](GeometryCache::Handle geometry) {
+            // Ignore results (failures too) for a source we've switched away from in the meantime
+            if (source != _source)
+                return;
+            if (!geometry)
+                emit statusChanged(_status = Error);
+            else if (geometry.key()->source == _source)
+                setGeometry(geometry);
+            else if (geometry.key()->source == glyphShape(_source))
+                setGlyphShape(geometry);
+        },
+        [this, source = _source](double progress) {
+            if (source == _source && _status == Loading && progress - _progress >= 0.01)
+                emit progressChanged(_progress = progress);
+        });
+}
+
+void MyVtkItem::setGeometry(GeometryCache::Handle geometry)
+{
+    _cloud = nullptr;
+    emit progressChanged(_progress = 1);
+    emit statusChanged(_status = geometry.polyData() && geometry.polyData()->GetNumberOfPoints() ? Ready : Error);
+
+    // The geometry is rendered by every view showing the source, with threadedRendering all of them on one worker
+    setRenderAffinity("MyVtkItem.source:" + geometry.key()->source);
+
+    bool reset = !std::exchange(_keepCamera, false);
+    dispatch_async([this, geometry, reset](vtkRenderWindow* renderWindow, vtkUserData userData) {
+        auto* vtk = Data::SafeDownCast(userData);
+        auto* pipeline = Pipeline::SafeDownCast(this->pipeline());
+
+        // Every view showing the same source shares one computed vtkPolyData; the previous one is released when
+        // the last view lets go of it.
+        pipeline->source = geometry.key()->source;
+        pipeline->geometry = geometry;
+        pipeline->lod = nullptr;
+        pipeline->stream = nullptr;
+        pipeline->streamed = nullptr;
+        pipeline->cloud = nullptr;
+        pipeline->instanced = false;
+        vtk->show(pipeline);
+
+        if (auto* polyData = pipeline->geometry.polyData(); polyData && polyData->GetNumberOfCells() > GeometryCache::LodCellBudget)
+            buildLod(pipeline->geometry);
+
+        if (reset)
+            resetCamera();
+        });
+}
+
+bool MyVtkItem::streaming() const
+{
+    return _streaming;
+}
+
+void MyVtkItem::setStreaming(bool v)
+{
+    if (_streaming != v)
+        emit streamingChanged(_streaming = v);
+}
+
+void MyVtkItem::stream(QString const& file)
+{
+    auto cancel = _streamCancel = std::make_shared<std::atomic<bool>>(false);
+
+    // Read the chunks on a worker thread and hand them to the GUI thread one by one, which forwards them to VTK
+    QThreadPool::globalInstance()->start([file, cancel, self = QPointer<MyVtkItem>(this)] {
+        auto stream = std::make_shared<MappedMeshStream>(file);
+        if (!stream->isValid())
+            qWarning() << Q_FUNC_INFO << "YIKES!!" << stream->errorString();
+        bool shown = stream->isValid() && stream->numberOfChunks() > 0;
+
+        for (int i = 0; i < stream->numberOfChunks() && !*cancel; ++i) {
+            vtkSmartPointer<vtkCellArray> cells = stream->chunk(i);
+            QMetaObject::invokeMethod(qApp, [self, cancel, stream, cells, i] {
+                if (self && !*cancel)
+                    self->appendChunk(stream, cells, i);
+                }, Qt::QueuedConnection);
+        }
+
+        // Done (or failed), swap in the shared memory-mapped geometry. It's the geometry streamed, so the camera
+        // stays where the user moved it while the chunks came in.
+        QMetaObject::invokeMethod(qApp, [self, cancel, shown] {
+            if (self && !*cancel) {
+                self->_keepCamera |= shown;
+                self->acquire();
+            }
+            }, Qt::QueuedConnection);
+        });
+}
+
+void MyVtkItem::appendChunk(std::shared_ptr<MappedMeshStream> const& stream, vtkSmartPointer<vtkCellArray> const& cells, int index)
+{
+    if (index < stream->numberOfChunks() - 1)
+        emit progressChanged(_progress = stream->progress(index));
+
+    // The streamed copy is ours alone
+    if (index == 0)
+        setRenderAffinity({});
+
+    dispatch_async([this, stream, cells, index](vtkRenderWindow* renderWindow, vtkUserData userData) {
+        auto* vtk = Data::SafeDownCast(userData);
+        auto* pipeline = Pipeline::SafeDownCast(this->pipeline());
+
+        if (index == 0) {
+            pipeline->stream = stream;
+            pipeline->streamed = vtkSmartPointer<vtkPolyData>::New();
+            pipeline->streamed->SetPoints(stream->points());
+            pipeline->streamed->GetPointData()->SetNormals(stream->normals());
+            if (stream->isPointCloud())
+                pipeline->streamed->SetVerts(cells);
+            else
+                pipeline->streamed->SetPolys(cells);
+            pipeline->lod = nullptr;
+            pipeline->cloud = nullptr;
+            pipeline->instanced = false;
+            vtk->show(pipeline);
+
+            // All points are there from the start, so are the bounds
+            resetCamera();
+        } else {
+            // A chunk of a stream we've switched away from in the meantime?
+            if (pipeline->stream != stream)
+                return;
+
+            auto* target = stream->isPointCloud() ? pipeline->streamed->GetVerts() : pipeline->streamed->GetPolys();
+            target->Append(cells);
+            target->Modified();
+            pipeline->streamed->Modified();
+        }
+
+        scheduleRender();
+        });
+}
+
+int MyVtkItem::pointBudget() const
+{
+    return _pointBudget;
+}
+
+void MyVtkItem::setPointBudget(int v)
+{
+    if (_pointBudget == v)
+        return;
+
+    emit pointBudgetChanged(_pointBudget = v);
+
+    dispatch_async([this, v](vtkRenderWindow* renderWindow, vtkUserData userData) {
+        Data::SafeDownCast(userData)->pointBudget = v;
+        scheduleRender();
+        });
+}
+
+void MyVtkItem::openCloud(QString const& file)
+{
+    // Only the header and the node table are read up front, the nodes are loaded as the panes need them
+    QThreadPool::globalInstance()->start([file, source = _source, self = QPointer<MyVtkItem>(this)] {
+        QString error;
+        auto octree = PointCloudOctree::open(file, &error);
+        if (!octree)
+            qWarning() << Q_FUNC_INFO << "YIKES!!" << error;
+
+        QMetaObject::invokeMethod(qApp, [self, source, octree] {
+            // Ignore results for a source we've switched away from in the meantime
+            if (self && self->_source == source)
+                self->setCloud(source, octree);
+            }, Qt::QueuedConnection);
+        });
+}
+
+void MyVtkItem::setCloud(QString const& source, std::shared_ptr<PointCloudOctree> octree)
+{
+    _cloud = octree;
+    emit progressChanged(_progress = 1);
+    emit statusChanged(_status = octree ? Ready : Error);
+
+    if (!octree)
+        return;
+
+    // The loaded nodes are shared with every view of the cloud, see PointCloudCache
+    setRenderAffinity("MyVtkItem.source:" + source);
+
+    bool reset = !std::exchange(_keepCamera, false);
+    dispatch_async([this, source, octree, reset](vtkRenderWindow* renderWindow, vtkUserData userData) {
         auto* vtk = Data::SafeDownCast(userData);
-        // clang-format off
-        vtk->mapper->SetInputConnection(
-            _source == "Cone" ? vtk->cone->GetOutputPort()
-            : _source == "Sphere" ? vtk->sphere->GetOutputPort()
-            : _source == "Capsule" ? vtk->capsule->GetOutputPort()
-            : (qWarning() << Q_FUNC_INFO << "YIKES!! Unknown source:'" << _source << "'", nullptr));
-        // clang-format on
-
-        resetCamera();
+        auto* pipeline = Pipeline::SafeDownCast(this->pipeline());
+
+        // Every view showing the same cloud shares its loaded nodes, see PointCloudCache
+        pipeline->source = source;
+        pipeline->geometry = {};
+        pipeline->lod = nullptr;
+        pipeline->stream = nullptr;
+        pipeline->streamed = nullptr;
+        pipeline->cloud = octree;
+        pipeline->instanced = false;
+        vtk->show(pipeline);
+
+        if (reset)
+            resetCamera();
+        });
+}
+
+void MyVtkItem::setGlyphShape(GeometryCache::Handle shape)
+{
+    _cloud = nullptr;
+    emit progressChanged(_progress = 1);
+    emit statusChanged(_status = shape.polyData() && shape.polyData()->GetNumberOfPoints() ? Ready : Error);
+
+    // Shared with the views showing the shape itself
+    setRenderAffinity("MyVtkItem.source:" + shape.key()->source);
+
+    bool reset = !std::exchange(_keepCamera, false);
+    dispatch_async([this, source = _source, shape, reset](vtkRenderWindow* renderWindow, vtkUserData userData) {
+        auto* vtk = Data::SafeDownCast(userData);
+        auto* pipeline = Pipeline::SafeDownCast(this->pipeline());
+
+        // The shape is shared with every view showing it, as a source of its own or as glyphs
+        pipeline->source = source;
+        pipeline->geometry = shape;
+        pipeline->lod = nullptr;
+        pipeline->stream = nullptr;
+        pipeline->streamed = nullptr;
+        pipeline->cloud = nullptr;
+        pipeline->instanced = true;
+        pipeline->frameGlyphs = reset && !pipeline->glyphs.count();
+        vtk->show(pipeline);
+
+        if (reset)
+            resetCamera();
+        });
+}
+
+void MyVtkItem::setGlyphs(GlyphInstances glyphs)
+{
+    if (!glyphs.isValid()) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! Inconsistent glyph arrays for" << glyphs.count() << "instances";
+        return;
+    }
+
+    _glyphs = std::move(glyphs);
+    updateGlyphs();
+}
+
+void MyVtkItem::setGlyphPositions(QVector<float> positions)
+{
+    if (positions.size() != _glyphs.positions.size()) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! Expected" << _glyphs.positions.size() << "coordinates, got" << positions.size();
+        return;
+    }
+
+    _glyphs.positions = std::move(positions);
+    updateGlyphs();
+}
+
+void MyVtkItem::setGlyphColors(QVector<quint8> colors)
+{
+    if (colors.size() != 4 * _glyphs.count()) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! Expected" << 4 * _glyphs.count() << "color components, got" << colors.size();
+        return;
+    }
+
+    _glyphs.colors = std::move(colors);
+    updateGlyphs();
+}
+
+void MyVtkItem::updateGlyphs()
+{
+    // One command per frame, it picks up the arrays set last before the GUI thread blocks for the sync
+    if (_glyphsPending)
+        return;
+    _glyphsPending = true;
+
+    dispatch_async([this](vtkRenderWindow* renderWindow, vtkUserData userData) {
+        auto* vtk = Data::SafeDownCast(userData);
+        auto* pipeline = Pipeline::SafeDownCast(this->pipeline());
+
+        // Shares the arrays, the GUI thread's next update detaches from them
+        pipeline->glyphs = _glyphs;
+        pipeline->glyphs.apply(pipeline->glyphPoints);
+        _glyphsPending = false;
+        vtk->show(pipeline);
+
+        // The shape showed up before there was anything to frame
+        if (pipeline->frameGlyphs && pipeline->instanced && pipeline->glyphs.count()) {
+            pipeline->frameGlyphs = false;
+            resetCamera();
+        }
+        });
+}
+
+QVector<double> MyVtkItem::times() const
+{
+    return _times;
+}
+
+double MyVtkItem::currentTime() const
+{
+    return _currentTime;
+}
+
+void MyVtkItem::setCurrentTime(double v)
+{
+    if (_currentTime == v)
+        return;
+    emit currentTimeChanged(_currentTime = v);
+
+    if (!_times.isEmpty()) {
+        seek(int(std::upper_bound(_times.cbegin(), _times.cend(), v) - _times.cbegin()) - 1);
+        updatePlayback();
+    }
+}
+
+bool MyVtkItem::playing() const
+{
+    return _playing;
+}
+
+void MyVtkItem::setPlaying(bool v)
+{
+    if (_playing != v) {
+        emit playingChanged(_playing = v);
+        updatePlayback();
+    }
+}
+
+double MyVtkItem::frameRate() const
+{
+    return _frameRate;
+}
+
+void MyVtkItem::setFrameRate(double v)
+{
+    if (v <= 0) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! Invalid frame rate:" << v;
+        return;
+    }
+
+    if (_frameRate != v) {
+        emit frameRateChanged(_frameRate = v);
+        updatePlayback();
+    }
+}
+
+int MyVtkItem::droppedSteps() const
+{
+    return _droppedSteps;
+}
+
+void MyVtkItem::updatePlayback()
+{
+    if (!_playing || _times.size() < 2) {
+        _playTimer.stop();
+        return;
+    }
+
+    // Restarts the clock from the current step, so it doesn't jump. Ticking at twice the frame rate keeps the
+    // timer's jitter from skipping steps.
+    _playFrom = qMax(0, _step);
+    _playClock.restart();
+    _playTimer.start(qMax(1, int(500 / _frameRate)));
+}
+
+void MyVtkItem::advance()
+{
+    auto n = int(_times.size());
+    auto step = int((_playFrom + qint64(_playClock.elapsed() * _frameRate / 1000)) % n);
+    if (step == _step)
+        return;
+
+    // Steps the clock went past, e.g. while the GUI thread was busy, are dropped as well
+    if (auto skipped = (step - qMax(0, _step) - 1 + n) % n)
+        emit droppedStepsChanged(_droppedSteps += skipped);
+
+    emit currentTimeChanged(_currentTime = _times[step]);
+    seek(step);
+}
+
+void MyVtkItem::seek(int step)
+{
+    step = qBound(0, step, int(_times.size()) - 1);
+    if (step == _step)
+        return;
+
+    // Moving on from a step which never made it to the screen drops it
+    if (_playing && _step >= 0 && _shownStep != _step)
+        emit droppedStepsChanged(++_droppedSteps);
+
+    // Otherwise stepReady() shows it once it's computed, the previous step stays on screen meanwhile
+    _step = step;
+    if (auto handle = TimeSeriesCache::instance().get(_source, step))
+        showStep(handle);
+
+    QVector<int> next;
+    for (int i = 1; i <= s_prefetchSteps && i < _times.size(); ++i)
+        next << (step + i) % int(_times.size());
+    TimeSeriesCache::instance().prefetch(_source, next);
+}
+
+void MyVtkItem::stepReady(QString const& source, int step)
+{
+    if (source != _source || _step < 0 || step == _shownStep)
+        return;
+
+    // While playing, a step between the one on screen and the one at currentTime is better than none
+    auto n = int(_times.size());
+    auto ahead = [n, this](int s) { return (s - _shownStep + n) % n; };
+    if (step != _step && !(_playing && _shownStep >= 0 && ahead(step) < ahead(_step)))
+        return;
+
+    if (auto handle = TimeSeriesCache::instance().get(source, step))
+        showStep(handle);
+}
+
+void MyVtkItem::showStep(GeometryCache::Handle step)
+{
+    _shownStep = int(step.key()->params.value(0));
+    _cloud = nullptr;
+    setRenderAffinity("MyVtkItem.source:" + step.key()->source);
+
+    // The first step frames the view, the following ones keep the camera
+    bool reset = false;
+    if (_status == Loading) {
+        reset = !std::exchange(_keepCamera, false);
+        emit progressChanged(_progress = 1);
+        emit statusChanged(_status = step.polyData() && step.polyData()->GetNumberOfPoints() ? Ready : Error);
+    }
+
+    dispatch_async([this, step, reset](vtkRenderWindow* renderWindow, vtkUserData userData) {
+        auto* vtk = Data::SafeDownCast(userData);
+        auto* pipeline = Pipeline::SafeDownCast(this->pipeline());
+
+        // Every view showing the series shares its steps, see TimeSeriesCache. Steps have no level of detail,
+        // they'd be replaced before it's computed.
+        pipeline->source = step.key()->source;
+        pipeline->geometry = step;
+        pipeline->lod = nullptr;
+        pipeline->stream = nullptr;
+        pipeline->streamed = nullptr;
+        pipeline->cloud = nullptr;
+        pipeline->instanced = false;
+        vtk->show(pipeline);
+
+        if (reset)
+            resetCamera();
+        });
+}
+
+void MyVtkItem::buildLod(GeometryCache::Handle geometry)
+{
+    // Decimate on a worker thread, the result is shared by all views showing the same source
+    QThreadPool::globalInstance()->start([geometry, self = QPointer<MyVtkItem>(this)] {
+        vtkSmartPointer<vtkPolyData> lod = geometry.decimated();
+        if (!lod)
+            return;
+
+        QMetaObject::invokeMethod(qApp, [geometry, lod, self] {
+            if (self)
+                self->dispatch_async([self, geometry, lod](vtkRenderWindow* renderWindow, vtkUserData userData) {
+                    auto* vtk = Data::SafeDownCast(userData);
+                    auto* pipeline = Pipeline::SafeDownCast(self->pipeline());
+
+                    // Has the source changed in the meantime?
+                    if (pipeline->geometry.polyData() != geometry.polyData())
+                        return;
+
+                    pipeline->lod = lod;
+                    vtk->show(pipeline);
+                });
+            }, Qt::QueuedConnection);
+        });
+}
+
+void MyVtkItem::orbit(double azimuth, double elevation)
+{
+    _cameraMove.azimuth += azimuth;
+    _cameraMove.elevation += elevation;
+    moveCamera();
+}
+
+void MyVtkItem::pan(double dx, double dy)
+{
+    _cameraMove.dx += dx;
+    _cameraMove.dy += dy;
+    moveCamera();
+}
+
+void MyVtkItem::zoom(double factor)
+{
+    if (factor <= 0) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! Invalid zoom factor:" << factor;
+        return;
+    }
+
+    _cameraMove.zoom *= factor;
+    moveCamera();
+}
+
+void MyVtkItem::setPose(QVector3D position, QVector3D focalPoint, QVector3D viewUp)
+{
+    _cameraMove = {};
+    _cameraMove.pose = true;
+    _cameraMove.position = position;
+    _cameraMove.focalPoint = focalPoint;
+    _cameraMove.viewUp = viewUp;
+    moveCamera();
+}
+
+void MyVtkItem::moveCamera()
+{
+    // One command per frame, it picks up whatever was requested until the GUI thread blocks for the sync
+    if (_cameraMovePending)
+        return;
+    _cameraMovePending = true;
+
+    dispatch_async([this](vtkRenderWindow* renderWindow, vtkUserData userData) {
+        auto* vtk = Data::SafeDownCast(userData);
+        auto* pipeline = Pipeline::SafeDownCast(this->pipeline());
+        auto* camera = pipeline->activeCamera();
+
+        auto move = std::exchange(_cameraMove, {});
+        _cameraMovePending = false;
+
+        if (move.pose) {
+            camera->SetPosition(move.position.x(), move.position.y(), move.position.z());
+            camera->SetFocalPoint(move.focalPoint.x(), move.focalPoint.y(), move.focalPoint.z());
+            camera->SetViewUp(move.viewUp.x(), move.viewUp.y(), move.viewUp.z());
+        }
+
+        if (move.azimuth != 0 || move.elevation != 0) {
+            camera->Azimuth(move.azimuth);
+            camera->Elevation(move.elevation);
+        }
+        camera->OrthogonalizeViewUp();
+
+        if (move.dx != 0 || move.dy != 0) {
+            // The world space size of an item pixel on the focal plane
+            double pixel = 2 / qMax(1.0, height()) * (camera->GetParallelProjection()
+                ? camera->GetParallelScale()
+                : camera->GetDistance() * std::tan(vtkMath::RadiansFromDegrees(camera->GetViewAngle()) / 2));
+
+            // Dragging the scene to the right and down moves the camera to the left and up
+            double up[3], direction[3], right[3];
+            camera->GetViewUp(up);
+            camera->GetDirectionOfProjection(direction);
+            vtkMath::Cross(direction, up, right);
+
+            double position[3], focalPoint[3];
+            camera->GetPosition(position);
+            camera->GetFocalPoint(focalPoint);
+            for (int i = 0; i < 3; ++i) {
+                double offset = (-move.dx * right[i] + move.dy * up[i]) * pixel;
+                position[i] += offset;
+                focalPoint[i] += offset;
+            }
+            camera->SetPosition(position);
+            camera->SetFocalPoint(focalPoint);
+        }
+
+        if (move.zoom != 1) {
+            if (camera->GetParallelProjection())
+                camera->SetParallelScale(camera->GetParallelScale() / move.zoom);
+            else
+                camera->Dolly(move.zoom);
+        }
+
+        vtk->renderer->ResetCameraClippingRange();
+        scheduleRender();
+        });
+}
+
+void MyVtkItem::captureCamera(std::function<void(CameraState const&)> done)
+{
+    dispatch_async([this, done](vtkRenderWindow* renderWindow, vtkUserData userData) {
+        auto* camera = Pipeline::SafeDownCast(this->pipeline())->activeCamera();
+
+        CameraState state;
+        camera->GetPosition(state.position);
+        camera->GetFocalPoint(state.focalPoint);
+        camera->GetViewUp(state.viewUp);
+        state.viewAngle = camera->GetViewAngle();
+        state.parallelScale = camera->GetParallelScale();
+        state.parallelProjection = camera->GetParallelProjection();
+
+        QMetaObject::invokeMethod(qApp, [done, state] { done(state); }, Qt::QueuedConnection);
+        });
+}
+
+void MyVtkItem::restoreCamera(CameraState const& state)
+{
+    _keepCamera = true;
+    _cameraMove = {};
+
+    dispatch_async([this, state](vtkRenderWindow* renderWindow, vtkUserData userData) {
+        auto* vtk = Data::SafeDownCast(userData);
+        auto* camera = Pipeline::SafeDownCast(this->pipeline())->activeCamera();
+
+        camera->SetPosition(state.position);
+        camera->SetFocalPoint(state.focalPoint);
+        camera->SetViewUp(state.viewUp);
+        camera->SetViewAngle(state.viewAngle);
+        camera->SetParallelScale(state.parallelScale);
+        camera->SetParallelProjection(state.parallelProjection);
+
+        vtk->renderer->ResetCameraClippingRange();
+        scheduleRender();
+        });
+}
+
+MyVtkItem::PickMode MyVtkItem::pickMode() const
+{
+    return _pickMode;
+}
+
+void MyVtkItem::setPickMode(PickMode v)
+{
+    if (_pickMode != v)
+        emit pickModeChanged(_pickMode = v);
+}
+
+bool MyVtkItem::hoverPicking() const
+{
+    return _hoverPicking;
+}
+
+void MyVtkItem::setHoverPicking(bool v)
+{
+    if (_hoverPicking != v)
+        emit hoverPickingChanged(_hoverPicking = v);
+}
+
+void MyVtkItem::pick(QPointF point)
+{
+    runPick(point, false);
+}
+
+void MyVtkItem::hoverPick(QPointF point)
+{
+    // One hover pick at a time, it picks wherever the mouse is once it runs. The ID buffers would be captured
+    // again for every frame while the camera moves, so that waits for the interaction to end.
+    _hoverPoint = point;
+    if (_pickMode == BufferPick && interacting())
+        return;
+    if (!std::exchange(_hoverPickPending, true))
+        runPick(point, true);
+}
+
+void MyVtkItem::runPick(QPointF point, bool hover)
+{
+    dispatch_async([this, point, hover, self = QPointer<MyVtkItem>(this)](vtkRenderWindow* renderWindow, vtkUserData userData) {
+        auto* vtk = Data::SafeDownCast(userData);
+        auto* pipeline = Pipeline::SafeDownCast(this->pipeline());
+        auto at = hover ? _hoverPoint : point;
+
+        auto done = [self, at, hover](PickResult const& result) {
+            QMetaObject::invokeMethod(qApp, [self, at, hover, result] {
+                if (self)
+                    self->pickDone(at, hover, result);
+                }, Qt::QueuedConnection);
+        };
+
+        // Our renderer covers the bottom-left part of the framebuffer, see QQuickVtkItem's headroom
+        auto* origin = vtk->renderer->GetOrigin();
+        auto* size = vtk->renderer->GetSize();
+        double x = origin[0] + at.x() / qMax(1.0, width()) * size[0];
+        double y = origin[1] + (1 - at.y() / qMax(1.0, height())) * size[1];
+
+        // In the model's coordinates, see linkTransform
+        vtkNew<vtkMatrix4x4> inverse;
+        vtkMatrix4x4::Invert(pipeline->transform, inverse);
+        double ray[2][3];
+        for (int i = 0; i < 2; ++i) {
+            double world[4], model[4];
+            vtk->renderer->SetDisplayPoint(x, y, i);
+            vtk->renderer->DisplayToWorld();
+            vtk->renderer->GetWorldPoint(world);
+            inverse->MultiplyPoint(world, model);
+            for (int j = 0; j < 3; ++j)
+                ray[i][j] = model[j] / model[3];
+        }
+
+        if (_pickMode == BufferPick && vtk->actor->GetMapper() != vtk->lodMapper.Get() && !pipeline->instanced) {
+            vtkSmartPointer<vtkMatrix4x4> transform = vtkSmartPointer<vtkMatrix4x4>::New();
+            transform->DeepCopy(pipeline->transform);
+
+            // Otherwise the buffers are captured once the render this dispatch causes is done
+            if (vtk->isSelected())
+                done(vtk->lookup(x, y, ray, transform));
+            else {
+                if (vtk->pendingPicks.isEmpty())
+                    QMetaObject::invokeMethod(qApp, [self] {
+                        if (self)
+                            self->capturePicks();
+                        }, Qt::QueuedConnection);
+
+                Data::PendingPick pending = { x, y, {}, transform, done };
+                std::copy_n(&ray[0][0], 6, &pending.ray[0][0]);
+                vtk->pendingPicks.append(pending);
+            }
+            return;
+        }
+
+        auto geometry = pipeline->geometry;
+        if (pipeline->cloud || pipeline->streamed || pipeline->instanced || !geometry) {
+            done({});
+            return;
+        }
+
+        // The locator is built on first use and shared by every view of the source, the GUI and render threads
+        // never wait for it
+        Ray r;
+        std::copy_n(ray[0], 3, r.from);
+        std::copy_n(ray[1], 3, r.to);
+        vtkSmartPointer<vtkMatrix4x4> transform = vtkSmartPointer<vtkMatrix4x4>::New();
+        transform->DeepCopy(pipeline->transform);
+        QThreadPool::globalInstance()->start([geometry, r, transform, done] {
+            QQuickVtkTrace::Scope trace("pick");
+
+            PickResult result;
+            if (auto* locator = geometry.locator()) {
+                double t, x[3], pcoords[3];
+                int subId = 0;
+                vtkIdType cellId = -1;
+                vtkNew<vtkGenericCell> cell;
+                if (locator->IntersectWithLine(r.from, r.to, 0, t, x, pcoords, subId, cellId, cell))
+                    result = hit(cell, cellId, r, transform);
+            }
+            done(result);
             });
+        });
+}
+
+void MyVtkItem::Data::selectedArea(int area[4]) const
+{
+    auto* origin = renderer->GetOrigin();
+    auto* size = renderer->GetSize();
+    area[0] = origin[0];
+    area[1] = origin[1];
+    area[2] = origin[0] + size[0] - 1;
+    area[3] = origin[1] + size[1] - 1;
+}
+
+// Whether the ID buffers are those of the current frame
+bool MyVtkItem::Data::isSelected() const
+{
+    int area[4];
+    selectedArea(area);
+    return selectedScene && sceneTime() == selectedScene && std::equal(area, area + 4, selectedSize);
+}
+
+// Queued by a pick waiting for the ID buffers from the sync it was dispatched in, so this dispatch runs in the next
+// sync, after the frame the pick was made in has been rendered (by our worker too, see threadedRendering)
+void MyVtkItem::capturePicks()
+{
+    dispatch_async([](vtkRenderWindow* renderWindow, vtkUserData userData) {
+        Data::SafeDownCast(userData)->capture(renderWindow);
+        });
+}
+
+void MyVtkItem::Data::capture(vtkRenderWindow* renderWindow)
+{
+    if (pendingPicks.isEmpty())
+        return;
+    auto picks = std::exchange(pendingPicks, {});
+    auto* window = vtkOpenGLRenderWindow::SafeDownCast(renderWindow);
+
+    if (!isSelected()) {
+        QQuickVtkTrace::Scope trace("CaptureBuffers", this);
+
+        int area[4];
+        selectedArea(area);
+
+        // Through VTK's state cache, like a render, see QQuickVtkItem
+        auto* state = window->GetState();
+        state->Reset();
+        state->Push();
+        selector->SetRenderer(renderer);
+        selector->SetArea(unsigned(area[0]), unsigned(area[1]), unsigned(area[2]), unsigned(area[3]));
+        selector->SetFieldAssociation(cloud ? vtkDataObject::FIELD_ASSOCIATION_POINTS : vtkDataObject::FIELD_ASSOCIATION_CELLS);
+        bool captured = selector->CaptureBuffers();
+        state->Pop();
+
+        // The ID passes went to the framebuffer the item shows, which the render this dispatch causes overwrites,
+        // so the frame isn't rendered twice. Capturing renders, which may touch the scene itself.
+        selectedScene = captured ? sceneTime() : 0;
+        std::copy(area, area + 4, selectedSize);
+        if (!captured)
+            qWarning() << Q_FUNC_INFO << "YIKES!! Capturing the ID buffers failed";
+    }
+
+    for (auto const& pick : std::as_const(picks))
+        pick.done(selectedScene ? lookup(pick.x, pick.y, pick.ray, pick.transform) : PickResult());
+}
+
+MyVtkItem::PickResult MyVtkItem::Data::lookup(double x, double y, double const ray[2][3], vtkMatrix4x4* transform) const
+{
+    PickResult result;
+
+    const unsigned position[2] = { unsigned(qMax(0.0, x)), unsigned(qMax(0.0, y)) };
+    auto info = selector->GetPixelInformation(position, s_pickTolerance);
+    if (!info.Valid || info.Prop != actor.Get() || info.AttributeID < 0)
+        return result;
+
+    // Points of clouds are numbered by the octree node they're in, see PointCloudOctree
+    if (cloud) {
+        auto block = int(info.CompositeID) - 1;
+        auto const& nodes = selection.nodes();
+        if (block < 0 || block >= nodes.size() || info.AttributeID >= selection.polyData()[block]->GetNumberOfPoints())
+            return result;
+
+        double p[4] = { 0, 0, 0, 1 }, world[4];
+        selection.polyData()[block]->GetPoint(info.AttributeID, p);
+        transform->MultiplyPoint(p, world);
+        result.pointId = qint64(cloud->nodes()[int(nodes[block])].firstPoint) + info.AttributeID;
+        result.position = QVector3D(float(world[0] / world[3]), float(world[1] / world[3]), float(world[2] / world[3]));
+        return result;
+    }
+
+    auto* polyData = vtkPolyData::SafeDownCast(mapper->GetInput());
+    vtkNew<vtkGenericCell> cell;
+    if (!polyData || !readCell(polyData, info.AttributeID, cell))
+        return result;
+
+    Ray r;
+    std::copy_n(ray[0], 3, r.from);
+    std::copy_n(ray[1], 3, r.to);
+    return hit(cell, info.AttributeID, r, transform);
+}
+
+void MyVtkItem::pickDone(QPointF point, bool hover, PickResult const& result)
+{
+    if (!hover) {
+        emit picked(point, result.cellId, result.pointId, result.position);
+        return;
+    }
+
+    _hoverPickPending = false;
+    emit hovered(point, result.cellId, result.pointId, result.position);
+
+    // The mouse moved on while we were picking
+    if (_hoverPicking && _hoverPoint != point)
+        hoverPick(_hoverPoint);
 }
 
 bool MyVtkItem::event(QEvent* ev)
@@ -133,8 +1385,24 @@ bool MyVtkItem::event(QEvent* ev)
     {
         if (!_click)
             return QQuickVtkItem::event(ev);
-        else
-            emit clicked();
+
+        emit clicked();
+        if (isSignalConnected(QMetaMethod::fromSignal(&MyVtkItem::picked)))
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+            pick(_click->localPos());
+#else
+            pick(_click->position());
+#endif
+        break;
+    }
+    case QEvent::HoverMove:
+    {
+        if (_hoverPicking)
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+            hoverPick(static_cast<QHoverEvent*>(ev)->posF());
+#else
+            hoverPick(static_cast<QHoverEvent*>(ev)->position());
+#endif
         break;
     }
     default:
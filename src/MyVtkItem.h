@@ -1,49 +1,226 @@
 #pragma once
 
 #include "QQuickVtkItem.h"
+#include "GeometryCache.h"
+#include "Glyphs.h"
+#include "MappedMesh.h"
+#include "PointCloud.h"
+#include "TimeSeries.h"
 
 #include <vtkActor.h>
 #include <vtkCamera.h>
-#include <vtkCapsuleSource.h>
-#include <vtkConeSource.h>
+#include <vtkGlyph3DMapper.h>
+#include <vtkHardwareSelector.h>
+#include <vtkPolyData.h>
 #include <vtkPolyDataMapper.h>
 #include <vtkRenderWindow.h>
 #include <vtkRenderWindowInteractor.h>
 #include <vtkRenderer.h>
 #include <vtkRendererCollection.h>
-#include <vtkSphereSource.h>
 #include <vtkInteractorStyleTrackball.h>
+#include <vtkMatrix4x4.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkPointGaussianMapper.h>
+#include <vtkWeakPointer.h>
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QPointF>
+#include <QtCore/QTimer>
+#include <QtGui/QMatrix4x4>
+#include <QtGui/QVector3D>
+
+#include <atomic>
+#include <functional>
+#include <memory>
 
 struct MyVtkItem : QQuickVtkItem
 {
     Q_OBJECT
         Q_PROPERTY(QString source READ source WRITE setSource NOTIFY sourceChanged)
+        Q_PROPERTY(Status status READ status NOTIFY statusChanged)
+        Q_PROPERTY(double progress READ progress NOTIFY progressChanged)
+        Q_PROPERTY(bool streaming READ streaming WRITE setStreaming NOTIFY streamingChanged)
+        Q_PROPERTY(QString linkGroup READ linkGroup WRITE setLinkGroup NOTIFY linkGroupChanged)
+        Q_PROPERTY(QMatrix4x4 linkTransform READ linkTransform WRITE setLinkTransform NOTIFY linkTransformChanged)
+        Q_PROPERTY(int pointBudget READ pointBudget WRITE setPointBudget NOTIFY pointBudgetChanged)
+        Q_PROPERTY(PickMode pickMode READ pickMode WRITE setPickMode NOTIFY pickModeChanged)
+        Q_PROPERTY(bool hoverPicking READ hoverPicking WRITE setHoverPicking NOTIFY hoverPickingChanged)
+        Q_PROPERTY(QVector<double> times READ times NOTIFY timesChanged)
+        Q_PROPERTY(double currentTime READ currentTime WRITE setCurrentTime NOTIFY currentTimeChanged)
+        Q_PROPERTY(bool playing READ playing WRITE setPlaying NOTIFY playingChanged)
+        Q_PROPERTY(double frameRate READ frameRate WRITE setFrameRate NOTIFY frameRateChanged)
+        Q_PROPERTY(int droppedSteps READ droppedSteps NOTIFY droppedStepsChanged)
 
 signals:
     void sourceChanged(QString);
+    void statusChanged(Status);
+    void progressChanged(double);
+    void streamingChanged(bool);
+    void linkGroupChanged(QString);
+    void linkTransformChanged(QMatrix4x4);
+    void pointBudgetChanged(int);
+    void pickModeChanged(PickMode);
+    void hoverPickingChanged(bool);
+    void timesChanged(QVector<double>);
+    void currentTimeChanged(double);
+    void playingChanged(bool);
+    void frameRateChanged(double);
+    void droppedStepsChanged(int);
 
     void clicked();
+
+    // What's under point, see pick(). cellId and pointId are -1 if there is nothing, position is in world
+    // coordinates. For point clouds cellId is -1 and pointId is the index of the point in the cloud's file.
+    void picked(QPointF point, qint64 cellId, qint64 pointId, QVector3D position);
+    void hovered(QPointF point, qint64 cellId, qint64 pointId, QVector3D position);
 public:
     MyVtkItem();
 
+    // The state of the source, which is executed on a worker thread. The previous geometry stays on screen while Loading.
+    enum Status { Null, Loading, Ready, Error };
+    Q_ENUM(Status)
+
+    // How pick() finds what's under a point:
+    //
+    //   LocatorPick: intersects the ray through the point with the source's geometry on a worker thread, through a
+    //                vtkStaticCellLocator built on first use and shared by every view of the source (see
+    //                GeometryCache::Handle::locator()). Nothing is rendered. Point clouds aren't picked.
+    //   BufferPick:  looks the point up in the cell (for point clouds: point) ID buffers of the frame, captured
+    //                with a vtkHardwareSelector at the sync after it was rendered. They're captured again only once
+    //                the camera, the geometry or the size changed, so hovering over a still frame is a lookup per
+    //                pick, and hover picks wait for the interaction to end. While the decimated geometry is shown
+    //                the locator is used instead.
+    enum PickMode { LocatorPick, BufferPick };
+    Q_ENUM(PickMode)
+
+    // The camera shared by all panes of a window with the same linkGroup. Render thread only.
+    struct CameraLink : vtkObject
+    {
+        static CameraLink* New();
+        vtkTypeMacro(CameraLink, vtkObject);
+
+        // Returns the window's link of that name, creating it from a copy of seed if there is none yet
+        static vtkSmartPointer<CameraLink> acquire(QQuickWindow* window, QString const& name, vtkCamera* seed);
+
+        vtkNew<vtkCamera> camera;
+
+        // The members' renderers, to frame what all of them show. Each Data is a member of one link at most,
+        // see Data::join().
+        QList<vtkWeakPointer<vtkRenderer>> renderers;
+
+        // Points camera at the union of what the members show, seen from its current direction, so all of it is
+        // in view in every member
+        void resetCamera();
+
+        // Set by the first resetCamera() of a frame, cleared when the members start rendering
+        bool resetDone = false;
+    };
+
+    // The CPU side, survives the QSGNode
+    struct Pipeline : vtkObject
+    {
+        static Pipeline* New();
+        vtkTypeMacro(Pipeline, vtkObject);
+
+        vtkNew<vtkCamera> camera;
+
+        // Replaces camera while linked
+        QString linkGroup;
+        vtkSmartPointer<CameraLink> link;
+        vtkNew<vtkMatrix4x4> transform;
+        vtkCamera* activeCamera() const { return link ? link->camera.Get() : camera.Get(); }
+        void renderStarted();
+
+        // Shared with every other view showing the same source, see GeometryCache
+        QString source;
+        GeometryCache::Handle geometry;
+        vtkSmartPointer<vtkPolyData> lod;
+
+        // Shown instead of geometry while a file-backed source is streaming in, see MyVtkItem::streaming
+        std::shared_ptr<MappedMeshStream> stream;
+        vtkSmartPointer<vtkPolyData> streamed;
+
+        // Replaces geometry for point cloud sources, see PointCloudOctree
+        std::shared_ptr<PointCloudOctree> cloud;
+
+        // Set for glyph sources: geometry is then their shape, drawn once per instance, see GlyphInstances
+        bool instanced = false;
+        GlyphInstances glyphs;
+        vtkNew<vtkPolyData> glyphPoints;
+
+        // Set while a shape shown without instances waits for them to reset the camera, unless it was restored
+        bool frameGlyphs = false;
+    };
+
+    struct PickResult
+    {
+        qint64 cellId = -1;
+        qint64 pointId = -1;
+        QVector3D position;
+    };
+
+    // The graphics side, recreated with the QSGNode
     struct Data : vtkObject
     {
         static Data* New();
         vtkTypeMacro(Data, vtkObject);
 
+        ~Data() override;
+
         vtkNew<vtkActor> actor;
         vtkNew<vtkRenderer> renderer;
-        vtkNew<vtkConeSource> cone;
-        vtkNew<vtkSphereSource> sphere;
-        vtkNew<vtkCapsuleSource> capsule;
+
+        // Leaves the link our renderer is a member of (if any) and joins link (if not null)
+        void join(CameraLink* link);
+        vtkWeakPointer<CameraLink> link;
         vtkNew<vtkPolyDataMapper> mapper;
         vtkNew<vtkInteractorStyleTrackballCamera> style;
+
+        // Renders the decimated geometry while interacting with adaptiveQuality, see QQuickVtkItem::adaptiveQuality
+        vtkNew<vtkPolyDataMapper> lodMapper;
+        bool useLod = false;
+
+        // Renders the octree nodes picked for the current camera, picked anew whenever the renderer starts
+        vtkNew<vtkPointGaussianMapper> cloudMapper;
+        vtkNew<vtkMultiBlockDataSet> cloudBlocks;
+        std::shared_ptr<PointCloudOctree> cloud;
+        PointCloudSelection selection;
+        qint64 pointBudget = 0;
+        void selectNodes();
+
+        // Draws the glyph instances of glyph sources
+        vtkNew<vtkGlyph3DMapper> glyphMapper;
+
+        void show(Pipeline* pipeline);
+
+        // The ID buffers of BufferPick and what they were captured for, see sceneTime()
+        vtkNew<vtkHardwareSelector> selector;
+        vtkMTimeType selectedScene = 0;
+        int selectedSize[4] = {};
+        vtkMTimeType sceneTime() const;
+        void selectedArea(int area[4]) const;
+        bool isSelected() const;
+
+        // Looks a point in display coordinates up in the ID buffers, which must be current (see isSelected()).
+        // ray is the line of sight through it in the model's coordinates.
+        PickResult lookup(double x, double y, double const ray[2][3], vtkMatrix4x4* transform) const;
+
+        // The picks waiting for the ID buffers, which capture() captures at the sync after the frame the picks
+        // were made in was rendered (see MyVtkItem::capturePicks()). Those still waiting once we're destroyed are
+        // done without a result.
+        struct PendingPick
+        {
+            double x, y;
+            double ray[2][3];
+            vtkSmartPointer<vtkMatrix4x4> transform;
+            std::function<void(PickResult const&)> done;
+        };
+        QList<PendingPick> pendingPicks;
+        void capture(vtkRenderWindow* renderWindow);
     };
 
+    vtkUserData initializePipeline() override;
     vtkUserData initializeVTK(vtkRenderWindow* renderWindow) override;
-    void destroyingVTK(vtkRenderWindow* renderWindow, vtkUserData userData);
-
-    vtkNew<vtkCamera> _camera;
 
     void resetCamera();
 
@@ -52,6 +229,158 @@ public:
     void setSource(QString v, bool forceVtk = false);
     QString _source;
 
+    Status status() const;
+    Status _status = Null;
+
+    double progress() const;
+    double _progress = 0;
+
+    void acquire();
+    void setGeometry(GeometryCache::Handle geometry);
+
+    // When enabled, file-backed sources are streamed in coarse to fine (see MappedMeshStream): the first chunk shows
+    // up within milliseconds and every further chunk refines the view, while the user may already interact with it.
+    // Once complete the streamed copy is replaced by the shared, memory-mapped geometry, keeping the camera. Sources
+    // some view holds computed already aren't streamed.
+    bool streaming() const;
+    void setStreaming(bool v);
+    bool _streaming = true;
+
+    void stream(QString const& file);
+    void appendChunk(std::shared_ptr<MappedMeshStream> const& stream, vtkSmartPointer<vtkCellArray> const& cells, int index);
+    std::shared_ptr<std::atomic<bool>> _streamCancel;
+
+    // Panes of a window with the same linkGroup share one camera and render in the same frame (see
+    // QQuickVtkItem::renderGroup). linkTransform is applied to this pane's model only, e.g. to look at
+    // the part from the other side while interacting with the group camera.
+    QString linkGroup() const;
+    void setLinkGroup(QString v);
+    QString _linkGroup;
+    void link(Data* vtk, Pipeline* pipeline);
+
+    QMatrix4x4 linkTransform() const;
+    void setLinkTransform(QMatrix4x4 v);
+    QMatrix4x4 _linkTransform;
+
+    // The most points a pane showing a point cloud renders, coarser nodes are picked to stay within it
+    int pointBudget() const;
+    void setPointBudget(int v);
+    int _pointBudget = 2000000;
+
+    /**
+    * The instances a glyph source ("Glyphs:<shape>", see glyphShape()) draws, which may be set at any time, e.g.
+    * before the source. setGlyphPositions() and setGlyphColors() replace just those arrays and are ignored (with a
+    * warning) unless they hold as many instances as shown. However often they are called, the render thread takes
+    * over the arrays once per frame, without copying, and the shape itself is never rebuilt.
+    */
+    void setGlyphs(GlyphInstances glyphs);
+    void setGlyphPositions(QVector<float> positions);
+    void setGlyphColors(QVector<quint8> colors);
+    GlyphInstances _glyphs;
+    bool _glyphsPending = false;
+    void updateGlyphs();
+    void setGlyphShape(GeometryCache::Handle shape);
+
+    void openCloud(QString const& file);
+    void setCloud(QString const& source, std::shared_ptr<PointCloudOctree> octree);
+    std::shared_ptr<PointCloudOctree> _cloud;
+
+    // Typed camera control, e.g. for animations and remote control. The camera (the group's camera while linked)
+    // is written directly instead of going through Qt events and the VTK interactor, and all moves requested within
+    // a frame are summed up and applied in a single command. Angles are in degrees, pan is in pixels of the item
+    // and zoom factors above 1 zoom in. setPose() discards the moves requested before it in the same frame.
+    Q_INVOKABLE void orbit(double azimuth, double elevation);
+    Q_INVOKABLE void pan(double dx, double dy);
+    Q_INVOKABLE void zoom(double factor);
+    Q_INVOKABLE void setPose(QVector3D position, QVector3D focalPoint, QVector3D viewUp);
+
+    struct CameraMove
+    {
+        bool pose = false;
+        QVector3D position, focalPoint, viewUp;
+        double azimuth = 0, elevation = 0;
+        double dx = 0, dy = 0;
+        double zoom = 1;
+    };
+    CameraMove _cameraMove;
+    bool _cameraMovePending = false;
+    void moveCamera();
+
+    // The camera (the group's camera while linked) as saved in a session snapshot, see Session
+    struct CameraState
+    {
+        double position[3] = { 0, 0, 1 };
+        double focalPoint[3] = { 0, 0, 0 };
+        double viewUp[3] = { 0, 1, 0 };
+        double viewAngle = 30;
+        double parallelScale = 1;
+        bool parallelProjection = false;
+    };
+
+    // Reads the camera at the next sync and calls done with it on the GUI thread
+    void captureCamera(std::function<void(CameraState const&)> done);
+
+    // Sets the camera, which is then kept when the source's geometry shows up instead of being reset to frame it
+    void restoreCamera(CameraState const& state);
+    bool _keepCamera = false;
+
+    PickMode pickMode() const;
+    void setPickMode(PickMode v);
+    PickMode _pickMode = LocatorPick;
+
+    // While enabled, what's under the mouse is picked as it hovers, at most one pick at a time, see hovered()
+    bool hoverPicking() const;
+    void setHoverPicking(bool v);
+    bool _hoverPicking = false;
+
+    /**
+    * Picks what's under point, in item coordinates, and emits picked(). Clicks are picked too while picked() is
+    * connected.
+    */
+    Q_INVOKABLE void pick(QPointF point);
+
+    void runPick(QPointF point, bool hover);
+    void capturePicks();
+    void pickDone(QPointF point, bool hover, PickResult const& result);
+    void hoverPick(QPointF point);
+    QPointF _hoverPoint;
+    bool _hoverPickPending = false;
+
+    // Time-series sources (see registerTimeSeries()) show their step at currentTime, i.e. the last one of times
+    // not after it. While playing, the steps follow each other at frameRate steps per second, looping: they follow
+    // the clock rather than wait for a step still being computed, those are dropped (see droppedSteps) and the
+    // previous step stays on screen instead. The steps coming up are prefetched, see TimeSeriesCache.
+    QVector<double> times() const;
+    QVector<double> _times;
+
+    double currentTime() const;
+    void setCurrentTime(double v);
+    double _currentTime = 0;
+
+    bool playing() const;
+    void setPlaying(bool v);
+    bool _playing = false;
+
+    double frameRate() const;
+    void setFrameRate(double v);
+    double _frameRate = 24;
+
+    int droppedSteps() const;
+    int _droppedSteps = 0;
+
+    void seek(int step);
+    void showStep(GeometryCache::Handle step);
+    void stepReady(QString const& source, int step);
+    void updatePlayback();
+    void advance();
+    int _step = -1;         // the step at currentTime
+    int _shownStep = -1;    // the step on screen
+    int _playFrom = 0;      // the step playback started from _playClock ago
+    QTimer _playTimer;
+    QElapsedTimer _playClock;
+
     bool event(QEvent* ev) override;
+
+    void buildLod(GeometryCache::Handle geometry);
     QScopedPointer<QMouseEvent> _click;
 };
\ No newline at end of file
@@ -0,0 +1,504 @@
+#include "PointCloud.h"
+#include "QQuickVtkTrace.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QPointer>
+#include <QtCore/QSaveFile>
+#include <QtCore/QThreadPool>
+
+#include <vtkCamera.h>
+#include <vtkFloatArray.h>
+#include <vtkMath.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkRenderer.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <queue>
+
+static const char s_magic[8] = { 'M', 'V', 'O', 'C', 'T', 0, 0, 0 };
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+std::shared_ptr<PointCloudOctree> PointCloudOctree::open(QString const& fileName, QString* error)
+{
+    static QMutex mutex;
+    static QHash<QString, std::weak_ptr<PointCloudOctree>> open;
+
+    auto fail = [error](QString const& message) {
+        if (error)
+            *error = message;
+        return nullptr;
+    };
+
+    auto path = QFileInfo(fileName).absoluteFilePath();
+
+    QMutexLocker lock(&mutex);
+    if (auto octree = open.value(path).lock())
+        return octree;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return fail(file.errorString());
+
+    std::shared_ptr<PointCloudOctree> octree(new PointCloudOctree);
+    octree->m_fileName = path;
+
+    auto& h = octree->m_header;
+    if (file.read(reinterpret_cast<char*>(&h), sizeof(h)) != qint64(sizeof(h))
+        || std::memcmp(h.magic, s_magic, sizeof(s_magic)) != 0 || h.version != Header::Version)
+        return fail(path + " is not a version 1 point cloud octree");
+
+    // Whether count elements at offset are within the file, without computing their size (which may overflow)
+    auto size = quint64(file.size());
+    auto fits = [size](quint64 offset, quint64 count, quint64 elementSize) { return offset <= size && count <= (size - offset) / elementSize; };
+    if (!h.numberOfNodes || !fits(h.nodes, h.numberOfNodes, sizeof(Node)) || !fits(h.points, h.numberOfPoints, 3 * sizeof(float))
+        || (h.colors && !fits(h.colors, h.numberOfPoints, 3)))
+        return fail(path + " is truncated or corrupt");
+
+    octree->m_nodes.resize(qsizetype(h.numberOfNodes));
+    if (!file.seek(qint64(h.nodes))
+        || file.read(reinterpret_cast<char*>(octree->m_nodes.data()), qint64(h.numberOfNodes * sizeof(Node))) != qint64(h.numberOfNodes * sizeof(Node)))
+        return fail(file.errorString());
+
+    // Children come after their parent, so walking the tree can't run in circles
+    for (quint64 i = 0; i < h.numberOfNodes; ++i) {
+        auto const& n = octree->m_nodes[qsizetype(i)];
+        if (n.firstPoint > h.numberOfPoints || n.pointCount > h.numberOfPoints - n.firstPoint
+            || (n.childMask && (n.firstChild <= i || quint64(n.firstChild) + qPopulationCount(n.childMask) > h.numberOfNodes)))
+            return fail(path + " is truncated or corrupt");
+    }
+
+    open.insert(path, octree);
+    return octree;
+}
+
+vtkSmartPointer<vtkPolyData> PointCloudOctree::readNode(quint32 index) const
+{
+    QQuickVtkTrace::Scope trace("readNode");
+
+    if (index >= quint32(m_nodes.size()))
+        return nullptr;
+    auto const& node = m_nodes[index];
+
+    // A QFile per read, so reads of different threads don't have to share a file position
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return nullptr;
+
+    vtkNew<vtkFloatArray> coordinates;
+    coordinates->SetNumberOfComponents(3);
+    coordinates->SetNumberOfTuples(node.pointCount);
+    auto bytes = qint64(node.pointCount) * 3 * qint64(sizeof(float));
+    if (!file.seek(qint64(m_header.points + node.firstPoint * 3 * sizeof(float)))
+        || file.read(reinterpret_cast<char*>(coordinates->GetPointer(0)), bytes) != bytes)
+        return nullptr;
+
+    auto polyData = vtkSmartPointer<vtkPolyData>::New();
+    vtkNew<vtkPoints> points;
+    points->SetData(coordinates);
+    polyData->SetPoints(points);
+
+    if (m_header.colors) {
+        vtkNew<vtkUnsignedCharArray> colors;
+        colors->SetName("Colors");
+        colors->SetNumberOfComponents(3);
+        colors->SetNumberOfTuples(node.pointCount);
+        bytes = qint64(node.pointCount) * 3;
+        if (!file.seek(qint64(m_header.colors + node.firstPoint * 3))
+            || file.read(reinterpret_cast<char*>(colors->GetPointer(0)), bytes) != bytes)
+            return nullptr;
+        polyData->GetPointData()->SetScalars(colors);
+    }
+
+    return polyData;
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+PointCloudCache& PointCloudCache::instance()
+{
+    static PointCloudCache cache;
+    return cache;
+}
+
+PointCloudCache::PointCloudCache()
+{
+    // We might be first used from a render thread, nodeLoaded() belongs to the GUI thread
+    if (auto* app = QCoreApplication::instance())
+        moveToThread(app->thread());
+}
+
+vtkSmartPointer<vtkPolyData> PointCloudCache::get(std::shared_ptr<PointCloudOctree> const& octree, quint32 node)
+{
+    Key key(octree->fileName(), node);
+
+    QMutexLocker lock(&m_mutex);
+
+    if (auto it = m_entries.find(key); it != m_entries.end()) {
+        it->used = ++m_clock;
+        return it->polyData;
+    }
+
+    if (m_loading.contains(key))
+        return nullptr;
+    m_loading.insert(key);
+
+    QThreadPool::globalInstance()->start([this, octree, node, key] {
+        auto polyData = octree->readNode(node);
+
+        {
+            QMutexLocker lock(&m_mutex);
+            m_loading.remove(key);
+            if (!polyData)
+                return;
+
+            Entry e;
+            e.polyData = polyData;
+            e.bytes = qint64(polyData->GetActualMemorySize()) * 1024;
+            e.used = ++m_clock;
+            m_entries.insert(key, e);
+            m_bytes += e.bytes;
+            evict();
+        }
+
+        QMetaObject::invokeMethod(this, [this] { emit nodeLoaded(); }, Qt::QueuedConnection);
+        });
+
+    return nullptr;
+}
+
+// Called with m_mutex locked
+void PointCloudCache::evict()
+{
+    if (m_bytes <= m_byteBudget)
+        return;
+
+    QList<QPair<quint64, Key>> lru;
+    lru.reserve(m_entries.size());
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it)
+        lru.append({ it->used, it.key() });
+    std::sort(lru.begin(), lru.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+
+    // Views still rendering an evicted node keep it alive until they pick another one
+    for (auto const& [used, key] : std::as_const(lru)) {
+        if (m_bytes <= m_byteBudget)
+            break;
+        m_bytes -= m_entries.take(key).bytes;
+    }
+}
+
+qint64 PointCloudCache::byteBudget() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_byteBudget;
+}
+
+void PointCloudCache::setByteBudget(qint64 bytes)
+{
+    QMutexLocker lock(&m_mutex);
+    m_byteBudget = bytes;
+    evict();
+}
+
+qint64 PointCloudCache::bytes() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_bytes;
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+bool PointCloudSelection::update(std::shared_ptr<PointCloudOctree> const& octree, vtkRenderer* renderer, qint64 pointBudget)
+{
+    QQuickVtkTrace::Scope trace("selectNodes");
+
+    auto const& nodes = octree->nodes();
+    auto* camera = renderer->GetActiveCamera();
+    int* size = renderer->GetSize();
+    if (size[0] <= 0 || size[1] <= 0)
+        return false;
+
+    double planes[24];
+    camera->GetFrustumPlanes(renderer->GetTiledAspectRatio(), planes);
+
+    double position[3];
+    camera->GetPosition(position);
+
+    // The size on screen, in pixels, of a world space distance at a distance from the camera
+    const double pixels = camera->GetParallelProjection()
+        ? size[1] / (2 * camera->GetParallelScale())
+        : size[1] / (2 * std::tan(vtkMath::RadiansFromDegrees(camera->GetViewAngle()) / 2));
+    auto projected = [&](PointCloudOctree::Node const& n) {
+        double radius = n.halfSize * std::sqrt(3.0);
+        if (camera->GetParallelProjection())
+            return radius * pixels;
+        double d = std::sqrt(vtkMath::Distance2BetweenPoints(position, n.center));
+        return d <= radius ? std::numeric_limits<double>::max() : radius / d * pixels;
+    };
+    auto visible = [&](PointCloudOctree::Node const& n) {
+        for (int p = 0; p < 6; ++p) {
+            double const* plane = planes + 4 * p;
+            double distance = plane[0] * n.center[0] + plane[1] * n.center[1] + plane[2] * n.center[2] + plane[3];
+            if (distance + n.halfSize * (std::abs(plane[0]) + std::abs(plane[1]) + std::abs(plane[2])) < 0)
+                return false;
+        }
+        return true;
+    };
+
+    QVector<quint32> selected;
+    QList<vtkSmartPointer<vtkPolyData>> polyData;
+    qint64 points = 0;
+
+    std::priority_queue<std::pair<double, quint32>> queue;
+    queue.push({ projected(nodes[0]), 0 });
+    while (!queue.empty()) {
+        auto [extent, index] = queue.top();
+        queue.pop();
+
+        auto const& n = nodes[int(index)];
+        if (!visible(n) || points + n.pointCount > pointBudget)
+            continue;
+
+        auto data = PointCloudCache::instance().get(octree, index);
+        if (!data)
+            continue;
+
+        selected << index;
+        polyData << data;
+        points += n.pointCount;
+
+        // Refine while the node's points are more than a pixel apart on screen
+        if (2 * extent / std::sqrt(double(qMax<quint32>(n.pointCount, 1))) <= 1)
+            continue;
+        for (quint32 bit = 0, child = n.firstChild; bit < 8; ++bit)
+            if (n.childMask & (1 << bit)) {
+                queue.push({ projected(nodes[int(child)]), child });
+                ++child;
+            }
+    }
+
+    m_points = points;
+    if (selected == m_nodes)
+        return false;
+
+    m_nodes = selected;
+    m_polyData = polyData;
+    return true;
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+namespace
+{
+    enum { NodeCapacity = 16384, MaxLevel = 20 };
+
+    struct BuildNode
+    {
+        double center[3];
+        double halfSize;
+        int level;
+        std::vector<quint64> points;        // kept in this node
+        std::unique_ptr<BuildNode> children[8];
+    };
+
+    // Keeps a spatially uniform subset of at most NodeCapacity points (the first point of each cell of a grid laid
+    // over the node) and hands the others down to the children
+    void build(BuildNode& node, std::vector<quint64>&& indices, vtkPoints* points)
+    {
+        if (indices.size() <= NodeCapacity || node.level >= MaxLevel) {
+            node.points = std::move(indices);
+            return;
+        }
+
+        const int grid = int(std::ceil(std::cbrt(double(NodeCapacity))));
+        std::vector<char> occupied(size_t(grid) * grid * grid, 0);
+        std::vector<quint64> rest[8];
+
+        for (auto i : indices) {
+            double p[3];
+            points->GetPoint(vtkIdType(i), p);
+
+            int cell[3];
+            int octant = 0;
+            for (int a = 0; a < 3; ++a) {
+                double t = (p[a] - (node.center[a] - node.halfSize)) / (2 * node.halfSize);
+                cell[a] = qBound(0, int(t * grid), grid - 1);
+                octant |= (p[a] >= node.center[a] ? 1 : 0) << a;
+            }
+
+            auto& o = occupied[(size_t(cell[2]) * grid + cell[1]) * grid + cell[0]];
+            if (!o && node.points.size() < NodeCapacity) {
+                o = 1;
+                node.points.push_back(i);
+            } else
+                rest[octant].push_back(i);
+        }
+        indices = {};
+
+        for (int octant = 0; octant < 8; ++octant) {
+            if (rest[octant].empty())
+                continue;
+
+            auto child = std::make_unique<BuildNode>();
+            child->halfSize = node.halfSize / 2;
+            child->level = node.level + 1;
+            for (int a = 0; a < 3; ++a)
+                child->center[a] = node.center[a] + (octant & (1 << a) ? 1 : -1) * child->halfSize;
+            build(*child, std::move(rest[octant]), points);
+            node.children[octant] = std::move(child);
+        }
+    }
+}
+
+bool writePointCloud(vtkPolyData* polyData, QString const& fileName, QString* error)
+{
+    auto fail = [error](QString const& message) {
+        if (error)
+            *error = message;
+        return false;
+    };
+
+    if (!polyData || !polyData->GetNumberOfPoints())
+        return fail("Nothing to write");
+
+    auto* points = polyData->GetPoints();
+    auto* scalars = vtkUnsignedCharArray::SafeDownCast(polyData->GetPointData()->GetScalars());
+    if (scalars && scalars->GetNumberOfComponents() != 3 && scalars->GetNumberOfComponents() != 4)
+        scalars = nullptr;
+
+    // The root is the bounding cube
+    double bounds[6];
+    polyData->GetBounds(bounds);
+    BuildNode root;
+    root.level = 0;
+    root.halfSize = 0;
+    for (int a = 0; a < 3; ++a) {
+        root.center[a] = (bounds[2 * a] + bounds[2 * a + 1]) / 2;
+        root.halfSize = qMax(root.halfSize, (bounds[2 * a + 1] - bounds[2 * a]) / 2);
+    }
+    root.halfSize = qMax(root.halfSize * 1.0001, 1e-9);
+
+    std::vector<quint64> all(size_t(polyData->GetNumberOfPoints()));
+    for (size_t i = 0; i < all.size(); ++i)
+        all[i] = i;
+    build(root, std::move(all), points);
+
+    // Breadth first, so the children of a node are consecutive
+    std::vector<BuildNode const*> order{ &root };
+    for (size_t i = 0; i < order.size(); ++i)
+        for (auto const& child : order[i]->children)
+            if (child)
+                order.push_back(child.get());
+
+    PointCloudOctree::Header header = {};
+    std::memcpy(header.magic, s_magic, sizeof(s_magic));
+    header.version = PointCloudOctree::Header::Version;
+    header.flags = scalars ? PointCloudOctree::Header::Colors : 0;
+    header.numberOfNodes = order.size();
+    header.numberOfPoints = quint64(polyData->GetNumberOfPoints());
+    header.nodes = sizeof(header);
+    header.points = header.nodes + header.numberOfNodes * sizeof(PointCloudOctree::Node);
+    header.colors = scalars ? header.points + header.numberOfPoints * 3 * sizeof(float) : 0;
+    for (int a = 0; a < 3; ++a) {
+        header.bounds[2 * a] = root.center[a] - root.halfSize;
+        header.bounds[2 * a + 1] = root.center[a] + root.halfSize;
+    }
+
+    std::vector<PointCloudOctree::Node> nodes(order.size());
+    quint64 firstPoint = 0;
+    quint32 nextChild = 1;
+    for (size_t i = 0; i < order.size(); ++i) {
+        auto const* b = order[i];
+        auto& n = nodes[i];
+        std::memcpy(n.center, b->center, sizeof(n.center));
+        n.halfSize = b->halfSize;
+        n.level = quint8(b->level);
+        n.firstPoint = firstPoint;
+        n.pointCount = quint32(b->points.size());
+        n.firstChild = nextChild;
+        for (int octant = 0; octant < 8; ++octant)
+            if (b->children[octant]) {
+                n.childMask |= quint8(1 << octant);
+                ++nextChild;
+            }
+        firstPoint += n.pointCount;
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return fail(file.errorString());
+
+    bool ok = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == qint64(sizeof(header))
+        && file.write(reinterpret_cast<const char*>(nodes.data()), qint64(nodes.size() * sizeof(PointCloudOctree::Node))) == qint64(nodes.size() * sizeof(PointCloudOctree::Node));
+
+    for (auto const* b : order) {
+        std::vector<float> xyz;
+        xyz.reserve(b->points.size() * 3);
+        for (auto i : b->points) {
+            double p[3];
+            points->GetPoint(vtkIdType(i), p);
+            xyz.insert(xyz.end(), { float(p[0]), float(p[1]), float(p[2]) });
+        }
+        auto bytes = qint64(xyz.size() * sizeof(float));
+        ok = ok && file.write(reinterpret_cast<const char*>(xyz.data()), bytes) == bytes;
+    }
+
+    if (scalars)
+        for (auto const* b : order) {
+            std::vector<unsigned char> rgb;
+            rgb.reserve(b->points.size() * 3);
+            for (auto i : b->points)
+                for (int c = 0; c < 3; ++c)
+                    rgb.push_back(scalars->GetValue(vtkIdType(i) * scalars->GetNumberOfComponents() + c));
+            auto bytes = qint64(rgb.size());
+            ok = ok && file.write(reinterpret_cast<const char*>(rgb.data()), bytes) == bytes;
+        }
+
+    if (!ok || !file.commit())
+        return fail(file.errorString());
+    return true;
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+static QMutex s_filesMutex;
+static QStringList s_sources;
+static QHash<QString, QString> s_files;
+
+QStringList registerPointClouds(QString const& directory)
+{
+    QStringList names;
+
+    QDir dir(directory);
+    for (auto const& info : dir.entryInfoList({ "*.mvoct" }, QDir::Files | QDir::Readable, QDir::Name)) {
+        QMutexLocker lock(&s_filesMutex);
+        if (!s_files.contains(info.fileName()))
+            s_sources << info.fileName();
+        s_files.insert(info.fileName(), info.absoluteFilePath());
+        names << info.fileName();
+    }
+
+    return names;
+}
+
+QString pointCloudFile(QString const& source)
+{
+    QMutexLocker lock(&s_filesMutex);
+    return s_files.value(source);
+}
+
+QStringList pointCloudSources()
+{
+    QMutexLocker lock(&s_filesMutex);
+    return s_sources;
+}
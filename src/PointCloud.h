@@ -0,0 +1,185 @@
+#pragma once
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+#include <vtkSmartPointer.h>
+
+#include <memory>
+
+class vtkCamera;
+class vtkPolyData;
+class vtkRenderer;
+
+/**
+* An out-of-core point cloud: an octree stored in an .mvoct file, of which only the node table is kept in memory.
+*
+*   PointCloudOctree::Header (128 bytes)
+*   nodes:  numberOfNodes * PointCloudOctree::Node, breadth first, the children of a node are consecutive
+*   points: numberOfPoints * 3 float32, the points of a node are consecutive
+*   colors: numberOfPoints * 3 uint8 (optional)
+*
+* Every node holds a spatially uniform subset of the points of its subtree that isn't held by any of its ancestors,
+* i.e. each point is stored once and a node together with its ancestors is a uniform sample of its cube. Rendering
+* any set of nodes closed under "parent of" thus gives a uniform density per node, finer where nodes are deeper.
+*
+* Use tools/MeshConvert to create .mvoct files.
+*
+* \note The file is read with plain (thread safe) reads from worker threads, see PointCloudCache.
+*/
+class PointCloudOctree
+{
+public:
+    struct Header
+    {
+        enum { Version = 1 };
+        enum Flags : quint32 { Colors = 1 };
+
+        char magic[8];          // "MVOCT\0\0\0"
+        quint32 version;
+        quint32 flags;
+        quint64 numberOfNodes;
+        quint64 numberOfPoints;
+        quint64 nodes;          // section offsets in bytes from the start of the file, colors is 0 if absent
+        quint64 points;
+        quint64 colors;
+        double bounds[6];
+        char reserved[24];
+    };
+
+    struct Node
+    {
+        double center[3];
+        double halfSize;
+        quint64 firstPoint;
+        quint32 pointCount;
+        quint32 firstChild;     // index of the first child (greater than the node's), the others follow in the order of childMask's bits
+        quint8 childMask;
+        quint8 level;
+        char reserved[14];
+    };
+
+    /**
+    * Opens an .mvoct file, every caller opening the same file while it's open gets the same object.
+    */
+    static std::shared_ptr<PointCloudOctree> open(QString const& fileName, QString* error = nullptr);
+
+    QString fileName() const { return m_fileName; }
+    Header const& header() const { return m_header; }
+    QVector<Node> const& nodes() const { return m_nodes; }
+
+    /**
+    * Reads the points (and colors) of a node into a new vtkPolyData. Blocking and thread safe.
+    */
+    vtkSmartPointer<vtkPolyData> readNode(quint32 index) const;
+
+private:
+    PointCloudOctree() = default;
+
+    QString m_fileName;
+    Header m_header = {};
+    QVector<Node> m_nodes;
+};
+static_assert(sizeof(PointCloudOctree::Header) == 128, "PointCloudOctree::Header must be 128 bytes");
+static_assert(sizeof(PointCloudOctree::Node) == 64, "PointCloudOctree::Node must be 64 bytes");
+
+/**
+* Process-wide LRU cache of loaded octree nodes, shared by all views: many views of one cloud cost about the
+* memory of one. Nodes are loaded on the global thread pool.
+*
+* \note Thread safe. nodeLoaded() is emitted on the GUI thread.
+*/
+class PointCloudCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static PointCloudCache& instance();
+
+    /**
+    * Returns the node if it's loaded, otherwise schedules loading it and returns nullptr.
+    */
+    vtkSmartPointer<vtkPolyData> get(std::shared_ptr<PointCloudOctree> const& octree, quint32 node);
+
+    /**
+    * The memory loaded nodes may occupy, least recently used nodes are evicted beyond it. 1 GiB by default.
+    */
+    qint64 byteBudget() const;
+    void setByteBudget(qint64 bytes);
+
+    qint64 bytes() const;
+
+Q_SIGNALS:
+    void nodeLoaded();
+
+private:
+    PointCloudCache();
+    void evict();
+
+    using Key = QPair<QString, quint32>;
+
+    struct Entry
+    {
+        vtkSmartPointer<vtkPolyData> polyData;
+        qint64 bytes = 0;
+        quint64 used = 0;
+    };
+
+    mutable QMutex m_mutex;
+    QHash<Key, Entry> m_entries;
+    QSet<Key> m_loading;
+    quint64 m_clock = 0;
+    qint64 m_bytes = 0;
+    qint64 m_byteBudget = qint64(1) << 30;
+};
+
+/**
+* Picks the octree nodes a view renders, by screen-space error within a point budget.
+*
+* Starting at the root, nodes are visited largest on screen first. A node inside the view frustum is rendered if
+* it's loaded and fits the budget, its children are visited if its points are still more than a pixel apart on
+* screen. Nodes which aren't loaded yet are requested from PointCloudCache; until then their ancestors stand in.
+*/
+class PointCloudSelection
+{
+public:
+    // Returns true if the selection changed since the last call
+    bool update(std::shared_ptr<PointCloudOctree> const& octree, vtkRenderer* renderer, qint64 pointBudget);
+
+    QList<vtkSmartPointer<vtkPolyData>> const& polyData() const { return m_polyData; }
+
+    // The indices of the nodes of polyData()
+    QVector<quint32> const& nodes() const { return m_nodes; }
+    qint64 numberOfPoints() const { return m_points; }
+
+private:
+    QVector<quint32> m_nodes;
+    QList<vtkSmartPointer<vtkPolyData>> m_polyData;
+    qint64 m_points = 0;
+};
+
+/**
+* Builds an .mvoct file from the points (and, if they are 3 or 4 component unsigned chars, the point scalars as
+* colors) of polyData. Returns false and sets error on failure.
+*
+* \note The whole cloud is built in memory.
+*/
+bool writePointCloud(vtkPolyData* polyData, QString const& fileName, QString* error = nullptr);
+
+/**
+* Registers every .mvoct file of directory as a point cloud source named after the file. Returns their names.
+*/
+QStringList registerPointClouds(QString const& directory);
+
+/**
+* The path of the .mvoct file behind a source registered by registerPointClouds(), or an empty string.
+*/
+QString pointCloudFile(QString const& source);
+
+QStringList pointCloudSources();
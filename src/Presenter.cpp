@@ -1,8 +1,8 @@
 #include "Presenter.h"
+#include "GeometryCache.h"
+#include "PointCloud.h"
 
 QStringList Presenter::sources() const
 {
-    return QStringList{} << "Cone"
-        << "Sphere"
-        << "Capsule";
+    return GeometryCache::instance().sources() + pointCloudSources();
 }
\ No newline at end of file
@@ -0,0 +1,321 @@
+#include "QQuickVtkCommandBuffer.h"
+
+#include <QtGui/QEnterEvent>
+#include <QtGui/QFocusEvent>
+#include <QtGui/QHoverEvent>
+#include <QtGui/QKeyEvent>
+#include <QtGui/QMouseEvent>
+#include <QtGui/QWheelEvent>
+
+#include <vtkInteractorStyle.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderWindowInteractor.h>
+
+#include <QVTKInteractorAdapter.h>
+
+#include <cstdlib>
+
+static bool isMergeable(QEvent::Type type)
+{
+    return type == QEvent::MouseMove || type == QEvent::HoverMove || type == QEvent::Wheel;
+}
+
+// Superseded by the next move, see QQuickVtkCommandBuffer
+static bool isDroppable(QEvent::Type type)
+{
+    return type == QEvent::MouseMove || type == QEvent::HoverMove;
+}
+
+QQuickVtkCommandBuffer::QQuickVtkCommandBuffer()
+{
+    for (int i = 0; i < Capacity - 1; ++i)
+        arena[i].next = i + 1;
+}
+
+void QQuickVtkCommandBuffer::push(Callback f)
+{
+    Command c;
+    c.kind = Command::Callback;
+    c.callback = std::move(f);
+    append(std::move(c));
+}
+
+bool QQuickVtkCommandBuffer::push(QEvent* ev)
+{
+    Command c;
+    c.type = ev->type();
+
+    switch (c.type)
+    {
+    case QEvent::MouseMove:
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseButtonDblClick:
+    {
+        auto e = static_cast<QMouseEvent*>(ev);
+        c.kind = Command::Mouse;
+        c.position = e->position();
+        c.scenePosition = e->scenePosition();
+        c.globalPosition = e->globalPosition();
+        c.button = e->button();
+        c.buttons = e->buttons();
+        c.modifiers = e->modifiers();
+        break;
+    }
+    case QEvent::HoverEnter:
+    case QEvent::HoverLeave:
+    case QEvent::HoverMove:
+    {
+        auto e = static_cast<QHoverEvent*>(ev);
+        c.kind = Command::Hover;
+        c.position = e->position();
+        c.globalPosition = e->globalPosition();
+        c.oldPosition = e->oldPosF();
+        c.modifiers = e->modifiers();
+        break;
+    }
+#ifndef QT_NO_WHEELEVENT
+    case QEvent::Wheel:
+    {
+        auto e = static_cast<QWheelEvent*>(ev);
+        c.kind = Command::Wheel;
+        c.position = e->position();
+        c.globalPosition = e->globalPosition();
+        c.pixelDelta = e->pixelDelta();
+        c.angleDelta = e->angleDelta();
+        c.buttons = e->buttons();
+        c.modifiers = e->modifiers();
+        c.phase = e->phase();
+        c.inverted = e->inverted();
+        break;
+    }
+#endif
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease:
+    {
+        auto e = static_cast<QKeyEvent*>(ev);
+        c.kind = Command::Key;
+        c.key = e->key();
+        c.modifiers = e->modifiers();
+        c.nativeScanCode = e->nativeScanCode();
+        c.nativeVirtualKey = e->nativeVirtualKey();
+        c.nativeModifiers = e->nativeModifiers();
+        c.text = e->text();
+        c.autoRepeat = e->isAutoRepeat();
+        c.repeatCount = quint16(e->count());
+        break;
+    }
+    case QEvent::FocusIn:
+    case QEvent::FocusOut:
+    {
+        c.kind = Command::Focus;
+        c.reason = static_cast<QFocusEvent*>(ev)->reason();
+        break;
+    }
+    case QEvent::Enter:
+    {
+        auto e = static_cast<QEnterEvent*>(ev);
+        c.kind = Command::Enter;
+        c.position = e->position();
+        c.scenePosition = e->scenePosition();
+        c.globalPosition = e->globalPosition();
+        break;
+    }
+    case QEvent::Leave:
+        c.kind = Command::Leave;
+        break;
+    case QEvent::DragEnter:
+    case QEvent::DragLeave:
+    case QEvent::DragMove:
+    case QEvent::Drop:
+    case QEvent::ContextMenu:
+    case QEvent::TouchBegin:
+    case QEvent::TouchUpdate:
+    case QEvent::TouchEnd:
+    case QEvent::TouchCancel:
+        c.kind = Command::Generic;
+        c.generic.reset(ev->clone());
+        break;
+    default:
+        return false;
+    }
+
+    if (merge(c))
+        ++merged;
+    else
+        append(std::move(c));
+
+    return true;
+}
+
+bool QQuickVtkCommandBuffer::merge(Command const& c)
+{
+    if (!count || !isMergeable(c.type))
+        return false;
+
+    auto& tail = overflow.empty() ? arena[last] : overflow.back();
+    if (tail.type != c.type || tail.buttons != c.buttons || tail.modifiers != c.modifiers)
+        return false;
+
+    switch (c.type)
+    {
+    case QEvent::Wheel:
+        if (tail.phase != c.phase || tail.inverted != c.inverted)
+            return false;
+        tail.pixelDelta += c.pixelDelta;
+        tail.angleDelta += c.angleDelta;
+        break;
+    case QEvent::HoverMove:
+        // keep the tail's oldPosition, the merged event spans both moves
+        break;
+    default:
+        break;
+    }
+
+    tail.position = c.position;
+    tail.scenePosition = c.scenePosition;
+    tail.globalPosition = c.globalPosition;
+    return true;
+}
+
+void QQuickVtkCommandBuffer::append(Command&& c)
+{
+    // The oldest move is the only thing we're allowed to lose, the moves after it make up for it
+    if (firstFree < 0 && overflow.empty() && firstMove >= 0) {
+        release(firstMove);
+        ++dropped;
+    }
+
+    ++count;
+    if (firstFree < 0 || !overflow.empty()) {
+        overflow.push_back(std::move(c));
+        return;
+    }
+
+    int slot = firstFree;
+    firstFree = arena[slot].next;
+
+    auto& s = arena[slot] = std::move(c);
+    s.prev = last;
+    s.next = -1;
+    s.nextMove = -1;
+    (last >= 0 ? arena[last].next : first) = slot;
+    last = slot;
+
+    if (isDroppable(s.type)) {
+        (lastMove >= 0 ? arena[lastMove].nextMove : firstMove) = slot;
+        lastMove = slot;
+    }
+}
+
+// Unlinks slot, which is either the first queued command or the first queued move
+void QQuickVtkCommandBuffer::release(int slot)
+{
+    auto& s = arena[slot];
+    (s.prev >= 0 ? arena[s.prev].next : first) = s.next;
+    (s.next >= 0 ? arena[s.next].prev : last) = s.prev;
+    if (slot == firstMove && (firstMove = s.nextMove) < 0)
+        lastMove = -1;
+
+    s = Command{};
+    s.next = firstFree;
+    firstFree = slot;
+    --count;
+}
+
+bool QQuickVtkCommandBuffer::takeFirst(Command& c)
+{
+    if (first >= 0) {
+        c = std::move(arena[first]);
+        release(first);
+        return true;
+    }
+
+    if (overflow.empty())
+        return false;
+
+    c = std::move(overflow.front());
+    overflow.pop_front();
+    --count;
+
+    // Give back what a flood took
+    if (overflow.empty())
+        std::deque<Command>().swap(overflow);
+    return true;
+}
+
+void QQuickVtkCommandBuffer::replay(QVTKInteractorAdapter& adapter, vtkRenderWindow* renderWindow, vtkSmartPointer<vtkObject> userData)
+{
+    Command c;
+    while (takeFirst(c))
+        execute(c, adapter, renderWindow, userData);
+}
+
+void QQuickVtkCommandBuffer::execute(Command& c, QVTKInteractorAdapter& adapter, vtkRenderWindow* renderWindow, vtkSmartPointer<vtkObject> const& userData)
+{
+    auto* iren = renderWindow->GetInteractor();
+
+    switch (c.kind)
+    {
+    case Command::Callback:
+        c.callback(renderWindow, userData);
+        break;
+    case Command::Mouse:
+    {
+        QMouseEvent e(c.type, c.position, c.scenePosition, c.globalPosition, c.button, c.buttons, c.modifiers);
+        adapter.ProcessEvent(&e, iren);
+        break;
+    }
+    case Command::Hover:
+    {
+        // note: The "scenePos" passed here ends up as QHoverEvent::position(), which is what VTK reads
+        QHoverEvent e(c.type, c.position, c.globalPosition, c.oldPosition, c.modifiers);
+        adapter.ProcessEvent(&e, iren);
+        break;
+    }
+    case Command::Wheel:
+    {
+        // VTK zooms a step per event reaching a notch (120), whatever its delta. The style's wheel factor makes a
+        // merged event zoom as far as all the notches it sums, the zoom being a power of that factor.
+        auto* style = vtkInteractorStyle::SafeDownCast(iren->GetInteractorStyle());
+        double notches = std::abs(c.angleDelta.x() + c.angleDelta.y()) / 120.0;
+        double factor = style ? style->GetMouseWheelMotionFactor() : 1;
+        if (style && notches > 1)
+            style->SetMouseWheelMotionFactor(factor * notches);
+
+        QWheelEvent e(c.position, c.globalPosition, c.pixelDelta, c.angleDelta, c.buttons, c.modifiers, c.phase, c.inverted);
+        adapter.ProcessEvent(&e, iren);
+
+        if (style && notches > 1)
+            style->SetMouseWheelMotionFactor(factor);
+        break;
+    }
+    case Command::Key:
+    {
+        QKeyEvent e(c.type, c.key, c.modifiers, c.nativeScanCode, c.nativeVirtualKey, c.nativeModifiers, c.text, c.autoRepeat, c.repeatCount);
+        adapter.ProcessEvent(&e, iren);
+        break;
+    }
+    case Command::Focus:
+    {
+        QFocusEvent e(c.type, c.reason);
+        adapter.ProcessEvent(&e, iren);
+        break;
+    }
+    case Command::Enter:
+    {
+        QEnterEvent e(c.position, c.scenePosition, c.globalPosition);
+        adapter.ProcessEvent(&e, iren);
+        break;
+    }
+    case Command::Leave:
+    {
+        QEvent e(QEvent::Leave);
+        adapter.ProcessEvent(&e, iren);
+        break;
+    }
+    case Command::Generic:
+        adapter.ProcessEvent(c.generic.get(), iren);
+        break;
+    }
+}
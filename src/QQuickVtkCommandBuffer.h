@@ -0,0 +1,135 @@
+#pragma once
+
+#include <QtCore/QEvent>
+#include <QtCore/QPoint>
+#include <QtCore/QPointF>
+#include <QtCore/QString>
+
+#include <vtkSmartPointer.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class QVTKInteractorAdapter;
+class vtkObject;
+class vtkRenderWindow;
+
+/**
+* The typed command buffer behind QQuickVtkItem::dispatch_async().
+*
+* Input events are stored by value in a fixed arena of Capacity commands, allocated once, instead of being cloned
+* to the heap and wrapped in a std::function. Consecutive MouseMove and HoverMove events are merged into the last
+* queued command, consecutive Wheel events too, their deltas summed: the merged event zooms as far as all of them
+* (see execute()). So no matter how fast input arrives at most Capacity commands are replayed while the GUI thread
+* is blocked.
+*
+* Once the arena is full the oldest queued move gives way to whatever comes next. Pushing, merging and dropping
+* are O(1). Only moves are ever dropped: presses, releases, wheel steps, keys and callbacks all make it to VTK, in
+* the order they were pushed. Should more than Capacity of those be queued within a frame (which takes a flood of
+* dispatch_async() calls rather than input), the rest wait in an overflow queue which is freed once replayed.
+*
+* \note Merging (and dropping) moves is lossless for VTK's interactor styles, they only ever look at the delta
+*       between the last and the current event position.
+*
+* \note Queuing an event allocates nothing, a key's text is implicitly shared with the event. What still does are
+*       callbacks whose captures don't fit into std::function and the rare events we don't model (drag & drop,
+*       context menu, touch), which are cloned.
+*
+* \note Must only be filled from the qt-gui-thread and replayed from the qml-render-thread while the GUI thread
+*       is blocked (i.e. in QQuickItem::updatePaintNode).
+*/
+class QQuickVtkCommandBuffer
+{
+public:
+    using Callback = std::function<void(vtkRenderWindow*, vtkSmartPointer<vtkObject>)>;
+
+    enum { Capacity = 256 };
+
+    QQuickVtkCommandBuffer();
+
+    /**
+    * Enqueues a user callback. Callbacks are never dropped nor merged, they run in order with the events.
+    */
+    void push(Callback f);
+
+    /**
+    * Enqueues (or merges) the given event. Returns false for event types that aren't forwarded to VTK.
+    */
+    bool push(QEvent* ev);
+
+    /**
+    * Replays and removes all queued commands in their original order. Commands pushed while replaying
+    * (e.g. from within a callback) are replayed as well.
+    */
+    void replay(QVTKInteractorAdapter& adapter, vtkRenderWindow* renderWindow, vtkSmartPointer<vtkObject> userData);
+
+    bool isEmpty() const { return !count; }
+    int size() const { return count; }
+
+    // Some statistics, never reset
+    quint64 merged = 0;
+    quint64 dropped = 0;
+
+private:
+    struct Command
+    {
+        enum Kind : quint8 { Callback, Mouse, Hover, Wheel, Key, Focus, Enter, Leave, Generic };
+
+        Kind kind = Callback;
+        QEvent::Type type = QEvent::None;
+
+        QPointF position;
+        QPointF scenePosition;
+        QPointF globalPosition;
+        QPointF oldPosition;
+        Qt::MouseButton button = Qt::NoButton;
+        Qt::MouseButtons buttons;
+        Qt::KeyboardModifiers modifiers;
+
+        QPoint pixelDelta;
+        QPoint angleDelta;
+        Qt::ScrollPhase phase = Qt::NoScrollPhase;
+        bool inverted = false;
+
+        int key = 0;
+        quint32 nativeScanCode = 0;
+        quint32 nativeVirtualKey = 0;
+        quint32 nativeModifiers = 0;
+        QString text;
+        bool autoRepeat = false;
+        quint16 repeatCount = 1;
+
+        Qt::FocusReason reason = Qt::OtherFocusReason;
+
+        // Rare events we don't model (drag & drop, context menu, touch) are still cloned
+        std::unique_ptr<QEvent> generic;
+
+        QQuickVtkCommandBuffer::Callback callback;
+
+        // Links between the arena's slots: the queue (or the free list), and the queued moves
+        int prev = -1;
+        int next = -1;
+        int nextMove = -1;
+    };
+
+    bool merge(Command const& c);
+    void append(Command&& c);
+    void release(int slot);
+    bool takeFirst(Command& c);
+    void execute(Command& c, QVTKInteractorAdapter& adapter, vtkRenderWindow* renderWindow, vtkSmartPointer<vtkObject> const& userData);
+
+    // Never resized, slots are linked in the order they were queued
+    std::vector<Command> arena = std::vector<Command>(Capacity);
+    int first = -1;
+    int last = -1;
+    int firstFree = 0;
+    int firstMove = -1;
+    int lastMove = -1;
+
+    // Commands queued while the arena was full, after those in the arena
+    std::deque<Command> overflow;
+
+    int count = 0;
+};
@@ -0,0 +1,285 @@
+#include "QQuickVtkFrameExport.h"
+#include "QQuickVtkTrace.h"
+
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#include <vtk_glew.h>
+#include <vtkOpenGLFramebufferObject.h>
+#include <vtkOpenGLRenderWindow.h>
+#include <vtkOpenGLState.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+QQuickVtkFrameReadback::~QQuickVtkFrameReadback()
+{
+    if (std::any_of(m_slots.cbegin(), m_slots.cend(), [](Slot const& s) { return s.pbo; }))
+        qWarning() << Q_FUNC_INFO << "YIKES!! Pixel buffers leaked, release() wasn't called";
+}
+
+bool QQuickVtkFrameReadback::read(vtkOpenGLRenderWindow* window, QSize const& size, Request request)
+{
+    if (m_count == Slots)
+        return false;
+
+    auto* fb = window->GetDisplayFramebuffer();
+    if (!fb || size.isEmpty())
+        return false;
+
+    QQuickVtkTrace::Scope trace("readback");
+
+    auto& slot = m_slots[(m_first + m_count) % Slots];
+    auto bytes = GLsizeiptr(size.width()) * size.height() * 4;
+    if (!slot.pbo)
+        glGenBuffers(1, &slot.pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    if (slot.size != size)
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+
+    // Through VTK's state cache, so VTK doesn't lose track of the bindings
+    auto* state = window->GetState();
+    state->PushReadFramebufferBinding();
+    fb->Bind(GL_READ_FRAMEBUFFER);
+    fb->ActivateReadBuffer(0);
+    state->vtkglPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, size.width(), size.height(), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    state->PopReadFramebufferBinding();
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.size = size;
+    slot.request = std::move(request);
+    slot.age = 0;
+    ++m_count;
+    return true;
+}
+
+bool QQuickVtkFrameReadback::collect(std::function<void(QImage, Request)> const& sink)
+{
+    while (m_count) {
+        auto& slot = m_slots[m_first];
+
+        // Give the GPU MaxLatency frames, then make sure it got the commands. Never wait, the render thread has
+        // better things to do: the frame is polled again in the next frame.
+        bool late = ++slot.age >= MaxLatency;
+        auto status = glClientWaitSync(GLsync(slot.fence), late ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            break;
+
+        QQuickVtkTrace::Scope trace("collect");
+
+        glDeleteSync(GLsync(slot.fence));
+        slot.fence = nullptr;
+
+        QImage image;
+        if (status != GL_WAIT_FAILED) {
+            auto bytes = qsizetype(slot.size.width()) * slot.size.height() * 4;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+            if (auto* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(bytes), GL_MAP_READ_BIT)) {
+                image = QImage(slot.size, QImage::Format_RGBA8888);
+                std::memcpy(image.bits(), pixels, size_t(bytes));
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        if (image.isNull())
+            qWarning() << Q_FUNC_INFO << "YIKES!! Reading a frame back failed";
+
+        auto request = std::exchange(slot.request, {});
+        m_first = (m_first + 1) % Slots;
+        --m_count;
+
+        sink(std::move(image), std::move(request));
+    }
+
+    return m_count;
+}
+
+void QQuickVtkFrameReadback::release()
+{
+    for (auto& slot : m_slots) {
+        if (slot.fence)
+            glDeleteSync(GLsync(slot.fence));
+        if (slot.pbo)
+            glDeleteBuffers(1, &slot.pbo);
+        slot = {};
+    }
+    m_first = m_count = 0;
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+QQuickVtkFrameEncoder::QQuickVtkFrameEncoder(std::function<void(QString, bool)> captured) : m_captured(std::move(captured))
+{}
+
+QQuickVtkFrameEncoder::~QQuickVtkFrameEncoder()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+bool QQuickVtkFrameEncoder::startRecording(QString const& fileName, QString* error)
+{
+    // Frames of a previous recording still in flight end up in this one
+    if (m_recording)
+        stopRecording();
+    finishRecording();
+
+    Item item;
+    item.kind = Item::Start;
+    item.fileName = fileName;
+
+    // Open the file right away, so we can tell whether it works
+    if (!fileName.contains("%1")) {
+        item.file = std::make_shared<QFile>(fileName);
+        if (!item.file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            if (error)
+                *error = item.file->errorString();
+            return false;
+        }
+    } else if (!QFileInfo(QFileInfo(fileName).path()).isWritable()) {
+        if (error)
+            *error = QFileInfo(fileName).path() + " is not writable";
+        return false;
+    }
+
+    m_recording = true;
+    m_dropped = 0;
+    enqueue(std::move(item));
+    return true;
+}
+
+void QQuickVtkFrameEncoder::stopRecording()
+{
+    if (!m_recording)
+        return;
+
+    m_recording = false;
+    m_stopping = true;
+}
+
+void QQuickVtkFrameEncoder::finishRecording()
+{
+    if (!m_stopping.exchange(false))
+        return;
+
+    Item item;
+    item.kind = Item::Stop;
+    enqueue(std::move(item));
+}
+
+void QQuickVtkFrameEncoder::push(QImage image, QQuickVtkFrameReadback::Request request)
+{
+    Item item;
+    item.image = std::move(image);
+    item.request = std::move(request);
+
+    // Frames which are only recorded are dropped when the queue is full, captures aren't
+    if (item.request.record && item.request.captures.isEmpty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queued + item.image.sizeInBytes() > m_memoryLimit) {
+            ++m_dropped;
+            return;
+        }
+    }
+
+    enqueue(std::move(item));
+}
+
+void QQuickVtkFrameEncoder::enqueue(Item&& item)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (item.request.record)
+            m_queued += item.image.sizeInBytes();
+        m_queue.enqueue(std::move(item));
+        if (!m_thread.joinable())
+            m_thread = std::thread(&QQuickVtkFrameEncoder::run, this);
+    }
+    m_wake.notify_one();
+}
+
+void QQuickVtkFrameEncoder::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this] { return m_quit || !m_queue.isEmpty(); });
+
+        // Write what is queued, even when quitting, so a recording isn't cut short
+        if (m_queue.isEmpty())
+            break;
+
+        auto item = m_queue.dequeue();
+        if (item.request.record)
+            m_queued -= item.image.sizeInBytes();
+
+        lock.unlock();
+        write(item);
+        lock.lock();
+    }
+
+    m_file.reset();
+}
+
+void QQuickVtkFrameEncoder::write(Item& item)
+{
+    switch (item.kind) {
+    case Item::Start:
+        m_file = item.file;
+        m_pattern = m_file ? QString() : item.fileName;
+        m_frameSize = {};
+        m_frame = 0;
+        return;
+    case Item::Stop:
+        if (m_file && m_frameSize.isValid())
+            qInfo().noquote() << m_file->fileName() << ":" << m_frame << "frames of" << m_frameSize.width() << "x" << m_frameSize.height() << "RGBA8888";
+        m_file.reset();
+        m_pattern.clear();
+        return;
+    case Item::Frame:
+        break;
+    }
+
+    QQuickVtkTrace::Scope trace("encode");
+
+    auto image = item.image.isNull() ? QImage() : item.image.mirrored();
+
+    for (auto const& fileName : std::as_const(item.request.captures)) {
+        bool ok = !image.isNull() && image.save(fileName);
+        if (!ok)
+            qWarning() << Q_FUNC_INFO << "YIKES!! Can't save:'" << fileName << "'";
+        if (m_captured)
+            m_captured(fileName, ok);
+    }
+
+    if (!item.request.record || image.isNull() || (!m_file && m_pattern.isEmpty()))
+        return;
+
+    if (!m_pattern.isEmpty()) {
+        auto fileName = m_pattern.arg(m_frame++, 6, 10, QChar('0'));
+        if (!image.save(fileName))
+            qWarning() << Q_FUNC_INFO << "YIKES!! Can't save:'" << fileName << "'";
+        return;
+    }
+
+    if (!m_frameSize.isValid())
+        m_frameSize = image.size();
+    if (image.size() != m_frameSize)
+        image = image.scaled(m_frameSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+    if (m_file->write(reinterpret_cast<const char*>(image.constBits()), image.sizeInBytes()) != image.sizeInBytes()) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! Can't write:'" << m_file->fileName() << "'" << m_file->errorString();
+        m_file.reset();
+        return;
+    }
+    ++m_frame;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <QtCore/QQueue>
+#include <QtCore/QSize>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtGui/QImage>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class QFile;
+class vtkOpenGLRenderWindow;
+
+/**
+* Reads rendered frames back from a VTK render window without stalling the render thread.
+*
+* Each read() only queues a glReadPixels into one of a ring of pixel buffer objects, guarded by a fence. collect(),
+* called once per frame, hands over the frames whose fence has signalled, always in the order they were read. It
+* never waits for the GPU: a frame still in flight after MaxLatency frames gets its commands flushed and is polled
+* again in the next frames. While the GPU lags behind the ring fills up and read() refuses further frames, which a
+* recording counts as dropped.
+*
+* \note Render thread only, with the OpenGL context of the VTK window current.
+*/
+class QQuickVtkFrameReadback
+{
+public:
+    enum { Slots = 3, MaxLatency = 2 };
+
+    // What a frame is read back for
+    struct Request
+    {
+        QStringList captures;   // files to save the frame to, see QQuickVtkItem::capture()
+        bool record = false;    // whether the frame belongs to the recording, see QQuickVtkItem::startRecording()
+    };
+
+    ~QQuickVtkFrameReadback();
+
+    /**
+    * Starts reading the bottom-left size pixels of the window's display framebuffer. Returns false (and reads
+    * nothing) if all slots are in flight.
+    */
+    bool read(vtkOpenGLRenderWindow* window, QSize const& size, Request request);
+
+    /**
+    * Passes the finished frames, oldest first, to sink. The images are bottom-up, as OpenGL stores them. Returns
+    * true while frames are still in flight, i.e. collect() has to be called again in one of the next frames.
+    */
+    bool collect(std::function<void(QImage, Request)> const& sink);
+
+    bool isEmpty() const { return !m_count; }
+
+    /**
+    * Drops the frames in flight and deletes the buffers.
+    */
+    void release();
+
+private:
+    struct Slot
+    {
+        unsigned pbo = 0;
+        void* fence = nullptr;  // GLsync
+        QSize size;
+        Request request;
+        int age = 0;
+    };
+
+    std::array<Slot, Slots> m_slots;
+    int m_first = 0;    // the oldest slot in flight
+    int m_count = 0;
+};
+
+/**
+* Saves and records the frames read back by QQuickVtkFrameReadback on a worker thread of its own.
+*
+* Frames are queued with push() and written in order: captures as images (the format follows the file suffix),
+* recorded frames either as an image sequence (if the file name contains "%1", which is replaced by the 6 digit
+* frame number) or appended to a raw video file: RGBA8888 frames, top row first, all of the size of the first
+* frame (later frames are scaled to it).
+*
+* The queue holds at most memoryLimit bytes of recorded frames, the ones which don't fit are dropped. Captures are
+* never dropped.
+*
+* \note push() is called from the render thread, everything else from the GUI thread. The captured callback is
+*       called from the worker thread.
+*/
+class QQuickVtkFrameEncoder
+{
+public:
+    explicit QQuickVtkFrameEncoder(std::function<void(QString fileName, bool ok)> captured);
+    ~QQuickVtkFrameEncoder();
+
+    bool startRecording(QString const& fileName, QString* error = nullptr);
+
+    /**
+    * Stops recording: recording() is false from now on, but the recording ends only with finishRecording(), once
+    * the frames read back before are pushed.
+    */
+    void stopRecording();
+    bool recording() const { return m_recording; }
+
+    // Whether stopRecording() waits for finishRecording()
+    bool stopping() const { return m_stopping; }
+
+    // Ends a stopped recording after the frames pushed so far. Called where the frames are read back, once none
+    // of the recording is in flight anymore (or they were released). Does nothing unless stopping().
+    void finishRecording();
+
+    // Takes a bottom-up image, see QQuickVtkFrameReadback::collect()
+    void push(QImage image, QQuickVtkFrameReadback::Request request);
+
+    // Counts a frame of the recording which couldn't be read back
+    void drop() { ++m_dropped; }
+    int dropped() const { return m_dropped; }
+
+    qint64 memoryLimit() const { return m_memoryLimit; }
+    void setMemoryLimit(qint64 bytes) { m_memoryLimit = bytes; }
+
+private:
+    struct Item
+    {
+        enum Kind { Frame, Start, Stop } kind = Frame;
+        QImage image;
+        QQuickVtkFrameReadback::Request request;
+        QString fileName;
+        std::shared_ptr<QFile> file;
+    };
+
+    void enqueue(Item&& item);
+    void run();
+    void write(Item& item);
+
+    std::function<void(QString, bool)> m_captured;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    QQueue<Item> m_queue;
+    qint64 m_queued = 0;        // bytes of recorded frames in m_queue
+    bool m_quit = false;
+    std::thread m_thread;       // started with the first item
+
+    bool m_recording = false;   // GUI thread's view
+    std::atomic<bool> m_stopping = false;
+    std::atomic<int> m_dropped = 0;
+    std::atomic<qint64> m_memoryLimit = qint64(256) << 20;
+
+    // Worker thread only: the recording being written
+    std::shared_ptr<QFile> m_file;
+    QString m_pattern;
+    QSize m_frameSize;
+    int m_frame = 0;
+};
@@ -1,4 +1,9 @@
 #include "QQuickVtkItem.h"
+#include "QQuickVtkCommandBuffer.h"
+#include "QQuickVtkFrameExport.h"
+#include "QQuickVtkRenderThread.h"
+#include "QQuickVtkShaderCache.h"
+#include "QQuickVtkTrace.h"
 
 #include <QtQuick/QSGTextureProvider>
 #include <QtQuick/QSGSimpleTextureNode>
@@ -6,17 +11,28 @@
 #include <QtQuick/QSGRenderNode>
 #include <QtQuick/QQuickWindow>
 
+#include <QtGui/QMouseEvent>
+#include <QtGui/QOffscreenSurface>
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QScreen>
 
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QEvent>
+#include <QtCore/QHash>
 #include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QPointer>
 #include <QtCore/QQueue>
 #include <QtCore/QThread>
+#include <QtCore/QTimer>
 #include <QtCore/QRunnable>
 #include <QtCore/QSharedPointer>
 
+#include <vtkActor.h>
 #include <vtkInteractorStyleTrackballCamera.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkSphereSource.h>
 #include <vtkGenericOpenGLRenderWindow.h>
 #include <vtkOpenGLFramebufferObject.h>
 #include <vtkRenderWindowInteractor.h>
@@ -28,6 +44,11 @@
 #include <QVTKInteractorAdapter.h>
 #include <QVTKInteractor.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <cmath>
 #include <limits>
 #include <queue>
 
@@ -44,14 +65,225 @@ public:
     QQuickVtkItemPrivate(QQuickVtkItem* ptr) : q_ptr(ptr)
     {}
 
-    QQueue<std::function<void(vtkRenderWindow*, QQuickVtkItem::vtkUserData)>> asyncDispatch;
+    QQuickVtkCommandBuffer asyncDispatch;
 
     QVTKInteractorAdapter qt2vtkInteractorAdapter;
 
     bool scheduleRender = false;
 
+    // Set when an input event was queued for VTK, only then the next render goes through the interactor
+    bool inputPending = false;
+
+    bool shareGraphicsResources = false;
+
+    // Threaded rendering, see QQuickVtkItem::threadedRendering(). The surface of the worker's context has to be
+    // created on the GUI thread, so it's created up front and handed to the node when it's (re)created.
+    bool threadedRendering = false;
+    std::shared_ptr<QOffscreenSurface> surface;
+
+    void createSurface()
+    {
+        Q_Q(QQuickVtkItem);
+
+        if (!threadedRendering || surface || !q->window())
+            return;
+
+        auto* s = new QOffscreenSurface(q->window()->screen());
+        s->setFormat(q->window()->format());
+        s->create();
+        if (!s->isValid())
+            qWarning().nospace() << "QQuickVTKItem.cpp:" << __LINE__ << ", YIKES!! Creating the offscreen surface failed, rendering on the render thread";
+
+        // Released by whichever thread drops the last reference, deleted on ours
+        surface.reset(s, [](QOffscreenSurface* s) { s->deleteLater(); });
+    }
+
+    int frameBudget = 12;
+
+    QString renderGroup;
+    QString renderAffinity;
+
+    // Set while our size keeps changing (e.g. a SplitView handle is being dragged), see geometryChange()
+    bool resizing = false;
+    QTimer resizeSettle;
+
+    // Adaptive quality, see QQuickVtkItem::adaptiveQuality()
+    bool adaptiveQuality = false;
+    int targetFrameTime = 16;
+    bool interacting = false;
+    QTimer idle;
+    qreal renderScale = 1;
+    quint64 renderScaleSample = 0;  // the node's render count when renderScale was last adapted
+
+    void setInteracting(bool v)
+    {
+        Q_Q(QQuickVtkItem);
+
+        if (interacting == v)
+            return;
+        emit q->interactingChanged(interacting = v);
+
+        // Render the one full quality frame
+        if (!interacting)
+            q->scheduleRender();
+    }
+
+    // Adapts renderScale so the render time gets close to targetFrameTime. The render time is expected to grow with
+    // the number of pixels, i.e. with the square of the scale.
+    void updateRenderScale(double lastRenderTime)
+    {
+        if (!adaptiveQuality || !interacting) {
+            renderScale = 1;
+            return;
+        }
+        if (lastRenderTime <= 0)
+            return;
+
+        auto ratio = targetFrameTime / lastRenderTime;
+        if (ratio > 0.9 && ratio < 1.1)
+            return;
+        renderScale = qBound(0.25, renderScale * qBound(0.7, std::sqrt(ratio), 1.1), 1.0);
+    }
+
+    // Visibility, see QQuickVtkItem::releaseDelay()
+    bool visible = true;
+    bool releaseGraphics = false;
+    QTimer release;
+
+    // Whether there is any chance for the user to see a single pixel of us: we must be visible, at least one
+    // device pixel in size and not entirely clipped away by our ancestors (or the window).
+    //
+    // Note: Being covered by sibling items is not detected.
+    bool effectivelyVisible() const
+    {
+        Q_Q(const QQuickVtkItem);
+
+        auto* w = q->window();
+        if (!w || !q->isVisible() || q->opacity() <= 0)
+            return false;
+
+        auto dpr = w->effectiveDevicePixelRatio();
+        if (q->width() * dpr < 1 || q->height() * dpr < 1)
+            return false;
+
+        auto rect = q->mapRectToScene(q->boundingRect()) & QRectF(QPointF(), w->size());
+        for (auto* p = q->parentItem(); p && !rect.isEmpty(); p = p->parentItem()) {
+            if (p->opacity() <= 0)
+                return false;
+            if (p->clip())
+                rect &= p->mapRectToScene(p->boundingRect());
+        }
+        return !rect.isEmpty();
+    }
+
+    // Qt only notifies us of changes of our own opacity and geometry (and of our effective visibility), those of
+    // our ancestors and of the window decide effectivelyVisible() as well. Rewatched whenever an ancestor changes.
+    QList<QMetaObject::Connection> ancestorConnections;
+
+    void watchAncestors()
+    {
+        Q_Q(QQuickVtkItem);
+
+        for (auto const& connection : std::as_const(ancestorConnections))
+            QObject::disconnect(connection);
+        ancestorConnections.clear();
+
+        auto changed = [this] { updateVisibility(); };
+        for (auto* p = q->parentItem(); p; p = p->parentItem()) {
+            ancestorConnections << QObject::connect(p, &QQuickItem::opacityChanged, q, changed)
+                << QObject::connect(p, &QQuickItem::clipChanged, q, changed)
+                << QObject::connect(p, &QQuickItem::xChanged, q, changed)
+                << QObject::connect(p, &QQuickItem::yChanged, q, changed)
+                << QObject::connect(p, &QQuickItem::widthChanged, q, changed)
+                << QObject::connect(p, &QQuickItem::heightChanged, q, changed)
+                << QObject::connect(p, &QQuickItem::parentChanged, q, [this] {
+                    watchAncestors();
+                    updateVisibility();
+                });
+        }
+        if (auto* w = q->window())
+            ancestorConnections << QObject::connect(w, &QWindow::widthChanged, q, changed)
+                << QObject::connect(w, &QWindow::heightChanged, q, changed);
+    }
+
+    // Called on the GUI thread whenever our visibility might have changed
+    void updateVisibility()
+    {
+        Q_Q(QQuickVtkItem);
+
+        auto v = effectivelyVisible();
+        if (visible == v)
+            return;
+
+        if (!(visible = v)) {
+            if (release.interval() >= 0)
+                release.start();
+        } else {
+            release.stop();
+            releaseGraphics = false;
+            q->update();
+        }
+    }
+
+    // Instrumentation, see QQuickVtkItem::dispatchTime()
+    struct Stats
+    {
+        double dispatchTime = 0;
+        double processEventsTime = 0;
+        double renderTime = 0;
+        double rebuildTime = 0;
+        int rebuildCount = 0;
+        int queueLength = 0;
+        int droppedFrames = 0;
+    } stats;
+    QElapsedTimer statsPublished;
+    QTimer statsTrailing;
+
+    // Called on the qml-render-thread with the GUI thread blocked. At most every 250 ms, a throttled update is
+    // published by statsTrailing once the interval is over, so the last one is never lost.
+    void publishStats()
+    {
+        Q_Q(QQuickVtkItem);
+
+        if (statsPublished.isValid() && statsPublished.elapsed() < 250) {
+            QMetaObject::invokeMethod(q, [this, delay = int(250 - statsPublished.elapsed())] {
+                if (!statsTrailing.isActive())
+                    statsTrailing.start(delay);
+            }, Qt::QueuedConnection);
+            return;
+        }
+        statsPublished.start();
+        QMetaObject::invokeMethod(q, [q] { emit q->statsChanged(); }, Qt::QueuedConnection);
+    }
+
+    // Frame export, see QQuickVtkItem::capture() and QQuickVtkItem::startRecording(). The encoder is shared with the
+    // node, which feeds it the frames it reads back.
+    std::shared_ptr<QQuickVtkFrameEncoder> encoder;
+    QStringList captures;
+    int recordingMemoryLimit = 256;
+
+    QQuickVtkFrameEncoder& frameEncoder()
+    {
+        Q_Q(QQuickVtkItem);
+
+        if (!encoder) {
+            encoder = std::make_shared<QQuickVtkFrameEncoder>([q = QPointer<QQuickVtkItem>(q)](QString fileName, bool ok) {
+                QMetaObject::invokeMethod(qApp, [q, fileName, ok] {
+                    if (q)
+                        emit q->captured(fileName, ok);
+                    }, Qt::QueuedConnection);
+                });
+            encoder->setMemoryLimit(qint64(recordingMemoryLimit) << 20);
+        }
+        return *encoder;
+    }
+
     mutable QSGVtkObjectNode* node = nullptr;
 
+    // The CPU side of the VTK pipeline, see QQuickVtkItem::initializePipeline()
+    QQuickVtkItem::vtkUserData pipeline;
+    bool pipelineInitialized = false;
+
 private:
     Q_DISABLE_COPY(QQuickVtkItemPrivate)
     Q_DECLARE_PUBLIC(QQuickVtkItem)
@@ -70,6 +302,38 @@ QQuickVtkItem::QQuickVtkItem(QQuickItem* parent) : QQuickItem(parent), d_ptr(new
 
     setFlag(QQuickItem::ItemIsFocusScope);
     setFlag(QQuickItem::ItemHasContents);
+
+    Q_D(QQuickVtkItem);
+    d->resizeSettle.setSingleShot(true);
+    d->resizeSettle.setInterval(150);
+    connect(&d->resizeSettle, &QTimer::timeout, this, [this] {
+        Q_D(QQuickVtkItem);
+        d->resizing = false;
+        update();
+    });
+
+    d->idle.setSingleShot(true);
+    d->idle.setInterval(250);
+    connect(&d->idle, &QTimer::timeout, this, [this] {
+        Q_D(QQuickVtkItem);
+        d->setInteracting(false);
+    });
+
+    d->release.setSingleShot(true);
+    d->release.setInterval(10000);
+    connect(&d->release, &QTimer::timeout, this, [this] {
+        Q_D(QQuickVtkItem);
+        d->releaseGraphics = true;
+        update();
+    });
+
+    // Fires on the GUI thread outside of any sync, so statsPublished is ours then
+    d->statsTrailing.setSingleShot(true);
+    connect(&d->statsTrailing, &QTimer::timeout, this, [this] {
+        Q_D(QQuickVtkItem);
+        d->statsPublished.start();
+        emit statsChanged();
+    });
 }
 
 QQuickVtkItem::~QQuickVtkItem() = default;
@@ -78,11 +342,309 @@ void QQuickVtkItem::dispatch_async(std::function<void(vtkRenderWindow*, vtkUserD
 {
     Q_D(QQuickVtkItem);
 
-    d->asyncDispatch.append(f);
+    d->asyncDispatch.push(std::move(f));
+
+    update();
+}
+
+bool QQuickVtkItem::shareGraphicsResources() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->shareGraphicsResources;
+}
+
+void QQuickVtkItem::setShareGraphicsResources(bool v)
+{
+    Q_D(QQuickVtkItem);
+
+    if (d->shareGraphicsResources != v)
+        emit shareGraphicsResourcesChanged(d->shareGraphicsResources = v);
+}
+
+bool QQuickVtkItem::threadedRendering() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->threadedRendering;
+}
+
+void QQuickVtkItem::setThreadedRendering(bool v)
+{
+    Q_D(QQuickVtkItem);
+
+    if (d->threadedRendering == v)
+        return;
+    emit threadedRenderingChanged(d->threadedRendering = v);
+    d->createSurface();
+}
+
+bool QQuickVtkItem::adaptiveQuality() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->adaptiveQuality;
+}
+
+void QQuickVtkItem::setAdaptiveQuality(bool v)
+{
+    Q_D(QQuickVtkItem);
+
+    if (d->adaptiveQuality != v) {
+        emit adaptiveQualityChanged(d->adaptiveQuality = v);
+        update();
+    }
+}
+
+int QQuickVtkItem::targetFrameTime() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->targetFrameTime;
+}
+
+void QQuickVtkItem::setTargetFrameTime(int v)
+{
+    Q_D(QQuickVtkItem);
+
+    if (d->targetFrameTime != v)
+        emit targetFrameTimeChanged(d->targetFrameTime = qMax(1, v));
+}
+
+int QQuickVtkItem::idleDelay() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->idle.interval();
+}
+
+void QQuickVtkItem::setIdleDelay(int v)
+{
+    Q_D(QQuickVtkItem);
+
+    if (d->idle.interval() != v) {
+        d->idle.setInterval(v);
+        emit idleDelayChanged(v);
+    }
+}
+
+bool QQuickVtkItem::interacting() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->interacting;
+}
+
+int QQuickVtkItem::frameBudget() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->frameBudget;
+}
+
+void QQuickVtkItem::setFrameBudget(int v)
+{
+    Q_D(QQuickVtkItem);
+
+    if (d->frameBudget != v) {
+        emit frameBudgetChanged(d->frameBudget = v);
+        update();
+    }
+}
+
+QString QQuickVtkItem::renderGroup() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->renderGroup;
+}
+
+void QQuickVtkItem::setRenderGroup(QString const& v)
+{
+    Q_D(QQuickVtkItem);
+
+    if (d->renderGroup != v) {
+        emit renderGroupChanged(d->renderGroup = v);
+        update();
+    }
+}
+
+QString QQuickVtkItem::renderAffinity() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->renderAffinity;
+}
+
+void QQuickVtkItem::setRenderAffinity(QString const& v)
+{
+    Q_D(QQuickVtkItem);
+
+    if (d->renderAffinity != v) {
+        emit renderAffinityChanged(d->renderAffinity = v);
+        update();
+    }
+}
+
+int QQuickVtkItem::releaseDelay() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->release.interval();
+}
+
+void QQuickVtkItem::setReleaseDelay(int v)
+{
+    Q_D(QQuickVtkItem);
+
+    if (d->release.interval() != v) {
+        d->release.setInterval(v);
+        emit releaseDelayChanged(v);
+    }
+}
+
+double QQuickVtkItem::dispatchTime() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->stats.dispatchTime;
+}
+
+double QQuickVtkItem::processEventsTime() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->stats.processEventsTime;
+}
+
+double QQuickVtkItem::renderTime() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->stats.renderTime;
+}
+
+double QQuickVtkItem::rebuildTime() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->stats.rebuildTime;
+}
+
+int QQuickVtkItem::rebuildCount() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->stats.rebuildCount;
+}
+
+int QQuickVtkItem::queueLength() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->stats.queueLength;
+}
+
+int QQuickVtkItem::droppedFrames() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->stats.droppedFrames;
+}
+
+int QQuickVtkItem::shaderCacheHits() const
+{
+    return QQuickVtkShaderCache::hits();
+}
+
+int QQuickVtkItem::shaderCacheMisses() const
+{
+    return QQuickVtkShaderCache::misses();
+}
+
+void QQuickVtkItem::capture(QString const& fileName)
+{
+    Q_D(QQuickVtkItem);
+
+    d->frameEncoder();
+    d->captures << fileName;
+    scheduleRender();
+}
+
+bool QQuickVtkItem::startRecording(QString const& fileName)
+{
+    Q_D(QQuickVtkItem);
+
+    bool was = recording();
+
+    QString error;
+    if (!d->frameEncoder().startRecording(fileName, &error)) {
+        qWarning().nospace() << "QQuickVTKItem.cpp:" << __LINE__ << ", YIKES!! Can't record to:'" << fileName << "' " << error;
+        if (was)
+            emit recordingChanged(false);
+        return false;
+    }
+
+    if (!was)
+        emit recordingChanged(true);
+    scheduleRender();
+    return true;
+}
 
+void QQuickVtkItem::stopRecording()
+{
+    Q_D(QQuickVtkItem);
+
+    if (!recording())
+        return;
+
+    d->encoder->stopRecording();
+    emit recordingChanged(false);
+
+    // The frames in flight are written at the next sync (see collect()), unless there is none
+    if (!window() || !isVisible())
+        d->encoder->finishRecording();
     update();
 }
 
+bool QQuickVtkItem::recording() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->encoder && d->encoder->recording();
+}
+
+int QQuickVtkItem::recordingMemoryLimit() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->recordingMemoryLimit;
+}
+
+void QQuickVtkItem::setRecordingMemoryLimit(int v)
+{
+    Q_D(QQuickVtkItem);
+
+    if (d->recordingMemoryLimit == v)
+        return;
+
+    emit recordingMemoryLimitChanged(d->recordingMemoryLimit = v);
+    if (d->encoder)
+        d->encoder->setMemoryLimit(qint64(v) << 20);
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+// Returns a never-rendered vtkRenderWindow for the share group of the given OpenGL context. It only exists to own
+// the vtkOpenGLVertexBufferObjectCache that every sharing VTK window of that share group hands its buffers to.
+//
+// Note: We deliberately don't share with a "real" window. VTK keeps a reference to the shared window, so sharing
+// with the window of another pane would keep that pane's window alive (and chain them) long after its QSGNode died.
+static vtkRenderWindow* sharedRenderWindow(QOpenGLContext* context)
+{
+    static QMutex mutex;
+    static QHash<QOpenGLContextGroup*, vtkSmartPointer<vtkGenericOpenGLRenderWindow>> anchors;
+
+    if (!context)
+        return nullptr;
+
+    auto* group = context->shareGroup();
+
+    QMutexLocker lock(&mutex);
+    auto& anchor = anchors[group];
+    if (!anchor) {
+        anchor = vtkSmartPointer<vtkGenericOpenGLRenderWindow>::New();
+        QObject::connect(group, &QObject::destroyed, [group] {
+            QMutexLocker lock(&mutex);
+            anchors.remove(group);
+        });
+    }
+    return anchor;
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
 #if 0
 void QQuickVtkItem::qtRect2vtkViewport(QRectF const& qtRect, double vtkViewport[4], QRectF* glRect)
 {
@@ -106,6 +668,79 @@ void QQuickVtkItem::qtRect2vtkViewport(QRectF const& qtRect, double vtkViewport[
 }
 #endif
 
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+// Renders the pending VTK nodes of one QQuickWindow within a frame budget.
+//
+// Instead of every node rendering from its own beforeRendering connection, the scheduler renders them in
+// priority order: views with interaction in flight first, then the focused view, then the others by how long
+// they've been waiting. Once the measured cost of the frame would exceed the budget the remaining nodes stay
+// pending and are rendered in one of the next frames (but never deferred more than MaxDeferrals times).
+//
+// Nodes of the same render group (see QQuickVtkItem::renderGroup) are scheduled as one batch: if any of them is
+// pending all of them render, one after the other, and the budget decision is taken for the batch as a whole.
+//
+// The scheduler also keeps a pool of initialized VTK windows (with their interactor) for the nodes of its window:
+// a new node takes one instead of creating and initializing its own, and a dying node gives its window back. The
+// windows keep their compiled shader programs, and a spare one is warmed up by rendering a typical scene once in
+// a quiet frame, so splitting a view doesn't stall the frame on window creation and shader compilation.
+//
+// Note: Lives on (and is only ever touched from) the qml-render-thread. It deletes itself with its last node.
+class QSGVtkRenderScheduler : public QObject
+{
+public:
+    static QSGVtkRenderScheduler* add(QQuickWindow* window, QSGVtkObjectNode* node);
+    void remove(QSGVtkObjectNode* node);
+
+    enum { MaxDeferrals = 4, PoolSize = 4, Spares = 1 };
+
+    // Returns an initialized VTK window from the pool (or a new one), without renderers
+    vtkSmartPointer<vtkGenericOpenGLRenderWindow> takeWindow(bool shareGraphicsResources);
+
+    // Takes a window back into the pool, returns false if the pool is full. The caller has released the graphics
+    // resources of its renderers.
+    bool recycle(vtkGenericOpenGLRenderWindow* window, bool shareGraphicsResources);
+
+    // Creates an initialized VTK window in the current context
+    static vtkSmartPointer<vtkGenericOpenGLRenderWindow> createWindow(bool shareGraphicsResources);
+
+    // Returns the worker a threaded node renders on: the oldest worker of the nodes sharing its render group or
+    // render affinity, a new one if there is none. Null if its context can't be created.
+    std::shared_ptr<QQuickVtkRenderThread> renderThread(QSGVtkObjectNode* node, std::shared_ptr<QOffscreenSurface> surface);
+
+    // Returns false if node has to move to an older worker, see QQuickVtkItem::renderAffinity. The nodes sharing
+    // a key with node on newer workers are stopped right away, they have to move to node's.
+    bool place(QSGVtkObjectNode* node);
+
+private:
+    explicit QSGVtkRenderScheduler(QQuickWindow* window);
+    ~QSGVtkRenderScheduler() override;
+    void render();
+    void frameEnded();
+
+    void warm(vtkGenericOpenGLRenderWindow* window);
+    int spares() const;
+    void replenish();
+
+    QQuickWindow* m_window;
+    QList<QSGVtkObjectNode*> m_nodes;
+
+    struct Pooled
+    {
+        vtkSmartPointer<vtkGenericOpenGLRenderWindow> window;
+        bool shareGraphicsResources = false;
+    };
+    QList<Pooled> m_pool;
+    bool m_lastShared = false;      // the kind of window the last node asked for, the kind of spare we keep
+
+    quint64 m_threadSerial = 0;     // of the newest worker, older workers have lower serials
+
+    static QMutex s_mutex;
+    static QHash<QQuickWindow*, QSGVtkRenderScheduler*> s_schedulers;
+};
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
 class QSGVtkObjectNode : public QSGTextureProvider, public QSGSimpleTextureNode
 {
     Q_OBJECT
@@ -119,14 +754,32 @@ public:
     {
         delete QSGVtkObjectNode::texture();
 
-        // Cleanup the VTK window resources
-        vtkWindow->GetRenderers()->InitTraversal(); while (auto renderer = vtkWindow->GetRenderers()->GetNextItem())
-            renderer->ReleaseGraphicsResources(vtkWindow);
-        vtkWindow->ReleaseGraphicsResources(vtkWindow);
-        vtkWindow = nullptr;
+        if (vtkWindow) {
+            exec([this] {
+                // Frames still in flight are lost
+                m_readback.release();
+                m_handoff.release();
+                if (m_encoder)
+                    m_encoder->finishRecording();
+
+                // Cleanup our renderers' resources and give the VTK window (and its compiled shaders) back to the pool,
+                // or release it too if the pool is full. Windows of a worker's context can't be pooled.
+                vtkWindow->GetRenderers()->InitTraversal(); while (auto renderer = vtkWindow->GetRenderers()->GetNextItem())
+                    renderer->ReleaseGraphicsResources(vtkWindow);
+                if (m_thread || !m_scheduler || !m_scheduler->recycle(vtkWindow, m_shareGraphicsResources))
+                    vtkWindow->ReleaseGraphicsResources(vtkWindow);
+                vtkWindow = nullptr;
+
+                // Cleanup the User Data
+                vtkUserData = nullptr;
+            });
+        }
+
+        // Joins the worker unless other nodes of our render group still use it
+        m_thread.reset();
 
-        // Cleanup the User Data
-        vtkUserData = nullptr;
+        if (m_scheduler)
+            m_scheduler->remove(this);
     }
 
     QSGTexture* texture() const override
@@ -134,32 +787,55 @@ public:
         return QSGSimpleTextureNode::texture();
     }
 
-    void initialize(QQuickVtkItem* item)
+    void initialize(QQuickVtkItem* item, std::shared_ptr<QOffscreenSurface> surface)
     {
-        // Create and initialize the vtkWindow
-        vtkWindow = vtkSmartPointer<vtkGenericOpenGLRenderWindow>::New();
-        vtkWindow->SetMultiSamples(0);
-        vtkWindow->SetReadyForRendering(false);
-        vtkWindow->SetFrameBlitModeToNoBlit();
-        vtkNew<QVTKInteractor> iren;
-        iren->SetRenderWindow(vtkWindow);
-        vtkNew<vtkInteractorStyleTrackballCamera> style;
-        iren->SetInteractorStyle(style);
-        vtkUserData = item->initializeVTK(vtkWindow);
-        if (auto ia = vtkWindow->GetInteractor(); ia && !QVTKInteractor::SafeDownCast(ia)) {
-            qWarning().nospace() << "QQuickVTKItem.cpp:" << __LINE__ << ", YIKES!! Only QVTKInteractor is supported";
-            return;
+        // With threadedRendering all of our VTK code runs on the worker of our render group and render affinity
+        if (surface) {
+            m_thread = m_scheduler->renderThread(this, std::move(surface));
+            if (!m_thread)
+                qWarning().nospace() << "QQuickVTKItem.cpp:" << __LINE__ << ", YIKES!! No render thread, rendering on the render thread";
         }
-        vtkWindow->GetRenderers()->InitTraversal(); while (auto renderer = vtkWindow->GetRenderers()->GetNextItem())
-            if (renderer->GetBackgroundAlpha() < 1./255)
-                renderer->SetBackgroundAlpha(1.0);
-        vtkWindow->SetReadyForRendering(false);
-        vtkWindow->GetInteractor()->Initialize();
-        vtkWindow->SetMapped(true);
-        vtkWindow->SetIsCurrent(true);
-        vtkWindow->SetForceMaximumHardwareLineWidth(1);
-        vtkWindow->SetOwnContext(false);
-        vtkWindow->OpenGLInitContext();
+
+        exec([this, item] {
+            // Take an initialized vtkWindow from our scheduler's pool, or create one in our worker's context. VTK
+            // objects can't be shared across threads, so a worker's windows never share their graphics resources.
+            vtkWindow = m_thread ? QSGVtkRenderScheduler::createWindow(false) : m_scheduler->takeWindow(m_shareGraphicsResources);
+            vtkUserData = item->initializeVTK(vtkWindow);
+            if (auto ia = vtkWindow->GetInteractor(); ia && !QVTKInteractor::SafeDownCast(ia)) {
+                qWarning().nospace() << "QQuickVTKItem.cpp:" << __LINE__ << ", YIKES!! Only QVTKInteractor is supported";
+                return;
+            }
+            vtkWindow->GetRenderers()->InitTraversal(); while (auto renderer = vtkWindow->GetRenderers()->GetNextItem())
+                if (renderer->GetBackgroundAlpha() < 1./255)
+                    renderer->SetBackgroundAlpha(1.0);
+            vtkWindow->SetReadyForRendering(false);
+        });
+    }
+
+    // Runs f where our VTK code runs: on our worker (and waits for it) with threadedRendering, right here otherwise
+    void exec(std::function<void()> f)
+    {
+        if (m_thread)
+            m_thread->exec(std::move(f));
+        else
+            f();
+    }
+
+    // What we share VTK objects with, see QSGVtkRenderScheduler::renderThread()
+    QStringList keys() const
+    {
+        QStringList keys;
+        if (!m_renderGroup.isEmpty())
+            keys << "group:" + m_renderGroup;
+        if (!m_renderAffinity.isEmpty())
+            keys << "affinity:" + m_renderAffinity;
+        return keys;
+    }
+
+    // Whether our VTK objects may be touched right now, i.e. our worker isn't rendering
+    bool isIdle() const
+    {
+        return !m_thread || m_thread->isIdle();
     }
 
     void scheduleRender()
@@ -168,33 +844,203 @@ public:
         m_window->update();
     }
 
+    // Frees the framebuffers and every other graphics resource of the VTK window but keeps the (CPU side) VTK
+    // pipeline. The next render recreates what is needed.
+    void releaseGraphicsResources()
+    {
+        exec([this] {
+            m_readback.release();
+            m_handoff.release();
+            if (m_encoder)
+                m_encoder->finishRecording();
+            vtkWindow->GetRenderers()->InitTraversal(); while (auto renderer = vtkWindow->GetRenderers()->GetNextItem())
+                renderer->ReleaseGraphicsResources(vtkWindow);
+            vtkWindow->ReleaseGraphicsResources(vtkWindow);
+        });
+        allocated = {};
+        m_released = true;
+    }
+
+    // Whether the scene graph would draw us at all (i.e. no ancestor blocks our subtree, e.g. because of visible: false)
+    bool isBlocked() const
+    {
+        for (auto* p = parent(); p; p = p->parent())
+            if (p->isSubtreeBlocked())
+                return true;
+        return false;
+    }
+
+    // Lays all renderers out in the visible, bottom-left part of the (possibly larger) allocated framebuffer.
+    // The renderers' viewports are expected to be expressed relative to the visible part, as if there was no headroom.
+    void setViewportScale(QSizeF const& scale)
+    {
+        vtkWindow->GetRenderers()->InitTraversal(); while (auto renderer = vtkWindow->GetRenderers()->GetNextItem()) {
+            double vp[4];
+            renderer->GetViewport(vp);
+            renderer->SetViewport(
+                vp[0] / m_viewportScale.width()  * scale.width(),
+                vp[1] / m_viewportScale.height() * scale.height(),
+                vp[2] / m_viewportScale.width()  * scale.width(),
+                vp[3] / m_viewportScale.height() * scale.height());
+        }
+        m_viewportScale = scale;
+    }
+
 public Q_SLOTS:
     void render()
     {
         if (m_renderPending) {
             m_renderPending = false;
 
+            // Threaded nodes render on their worker, the frame is picked up at one of the next syncs
+            if (m_thread) {
+                m_thread->post([this] {
+                    renderVtk();
+                    m_handoff.publish(vtkWindow, allocated, size);
+                    requestSync();
+                    });
+                return;
+            }
+
             const bool needsWrap = QSGRendererInterface::isApiRhiBased(m_window->rendererInterface()->graphicsApi());
             if (needsWrap)
                 m_window->beginExternalCommands();
 
-            // Render VTK into it's framebuffer
-            auto ostate = vtkWindow->GetState();
-            ostate->Reset();
-            ostate->Push();
-            ostate->vtkglDepthFunc(GL_LEQUAL);          // note: By default, Qt sets the depth function to GL_LESS but VTK expects GL_LEQUAL
-            vtkWindow->SetReadyForRendering(true);
-            vtkWindow->GetInteractor()->ProcessEvents();
-            vtkWindow->GetInteractor()->Render();
-            vtkWindow->SetReadyForRendering(false);
-            ostate->Pop();
+            renderVtk();
 
             if (needsWrap)
                 m_window->endExternalCommands();
 
+            // Only sample the part of the framebuffer we've actually rendered into
+            if (m_rendered != size) {
+                m_rendered = size;
+                setSourceRect(0, 0, m_rendered.width(), m_rendered.height());
+            }
+
             markDirty(QSGNode::DirtyMaterial);
             Q_EMIT textureChanged();
+
+            // A recording gets a frame in every frame of the window
+            if (m_recording)
+                scheduleRender();
+        }
+    }
+
+    // Renders VTK into its framebuffer, on the render thread or on our worker
+    void renderVtk()
+    {
+        // Render VTK into it's framebuffer
+        auto ostate = vtkWindow->GetState();
+        ostate->Reset();
+        ostate->Push();
+        ostate->vtkglDepthFunc(GL_LEQUAL);          // note: By default, Qt sets the depth function to GL_LESS but VTK expects GL_LEQUAL
+        QElapsedTimer timer;
+        timer.start();
+        vtkWindow->SetReadyForRendering(true);
+        if (m_inputPending) {
+            QQuickVtkTrace::Scope trace("ProcessEvents", m_item);
+            vtkWindow->GetInteractor()->ProcessEvents();
+        }
+        auto processed = timer.nsecsElapsed();
+        {
+            // Renders triggered by dispatch_async() alone (e.g. a camera written directly) skip the interactor
+            QQuickVtkTrace::Scope trace("Render", m_item);
+            if (m_inputPending)
+                vtkWindow->GetInteractor()->Render();
+            else
+                vtkWindow->Render();
+        }
+        m_inputPending = false;
+        vtkWindow->SetReadyForRendering(false);
+        m_processEventsTime = processed / 1e6;
+        m_renderTime = (timer.nsecsElapsed() - processed) / 1e6;
+        m_lastRenderTime = timer.nsecsElapsed() / 1e6;
+        ++m_renderCount;
+        m_cost = m_cost > 0 ? 0.8 * m_cost + 0.2 * m_lastRenderTime : m_lastRenderTime;
+
+        // Start reading the frame back for export, collectFrames() picks it up in one of the next frames
+        if (!m_captures.isEmpty() || m_recording) {
+            if (m_readback.read(vtkWindow, size, { m_captures, m_recording }))
+                m_captures.clear();
+            else if (m_recording)
+                m_encoder->drop();
+        }
+        ostate->Pop();
+
+        m_framesInFlight = !m_readback.isEmpty();
+    }
+
+    // Render thread: shows the last frame our worker published, if any, see QQuickVtkTextureHandoff
+    void showFrame()
+    {
+        if (!m_handoff.acquire())
+            return;
+
+        delete texture();
+        GLuint texId = m_handoff.texture();
+#if QT_VERSION < QT_VERSION_CHECK(6,0,0)
+        auto *texture = m_window->createTextureFromNativeObject(QQuickWindow::NativeObjectTexture, &texId, 0, m_handoff.textureSize(), QQuickWindow::TextureHasAlphaChannel);
+#else
+        auto *texture = QNativeInterface::QSGOpenGLTexture::fromNative(texId, m_window, m_handoff.textureSize(), QQuickWindow::TextureHasAlphaChannel);
+#endif
+        setTexture(texture);
+        m_rendered = m_handoff.frameSize();
+        setSourceRect(0, 0, m_rendered.width(), m_rendered.height());
+
+        markDirty(QSGNode::DirtyMaterial);
+        Q_EMIT textureChanged();
+    }
+
+    // Worker: has the item synced again, to show the frame we just published
+    void requestSync()
+    {
+        QMetaObject::invokeMethod(qApp, [item = m_itemGuard] {
+            if (item)
+                item->update();
+            }, Qt::QueuedConnection);
+    }
+
+    // Asks for another frame of the window, from the render thread or from our worker
+    void requestFrame()
+    {
+        if (!m_thread || QThread::currentThread() != m_thread.get()) {
+            m_window->update();
+            return;
         }
+        QMetaObject::invokeMethod(qApp, [window = QPointer<QQuickWindow>(m_window)] {
+            if (window)
+                window->update();
+            }, Qt::QueuedConnection);
+    }
+
+    // Hands the frames read back in previous frames to the encoder, see QQuickVtkFrameReadback. Called by the
+    // scheduler in every frame of the window.
+    void collectFrames()
+    {
+        if (!m_framesInFlight)
+            return;
+
+        // Our worker's frames are read back in its context
+        if (m_thread) {
+            m_thread->post([this] { collect(); });
+            return;
+        }
+        collect();
+    }
+
+    void collect()
+    {
+        bool inFlight = m_readback.collect([this](QImage image, QQuickVtkFrameReadback::Request request) {
+            if (m_encoder)
+                m_encoder->push(std::move(image), std::move(request));
+            });
+        m_framesInFlight = inFlight;
+
+        // Make sure there is a next frame to pick up the rest. A stopped recording ends with its last frame.
+        if (inFlight)
+            requestFrame();
+        else if (m_encoder && !m_recording)
+            m_encoder->finishRecording();
     }
 
     void handleScreenChange()
@@ -209,20 +1055,354 @@ private:
     vtkSmartPointer<vtkGenericOpenGLRenderWindow> vtkWindow;
     vtkSmartPointer<vtkObject> vtkUserData;
     bool m_renderPending = false;
+    bool m_inputPending = false;    // input was replayed since the last render, see QQuickVtkItemPrivate::inputPending
+    QSizeF m_viewportScale = { 1, 1 };
+    QSize m_rendered;
+    double m_lastRenderTime = 0;    // CPU-side milliseconds spent in the last render
+    quint64 m_renderCount = 0;      // renders so far, tells a new m_lastRenderTime from one seen before
+    double m_cost = 0;              // moving average of m_lastRenderTime
+    double m_processEventsTime = 0; // the two parts of m_lastRenderTime, see QQuickVtkItem::processEventsTime()
+    double m_renderTime = 0;
+    int m_deferrals = 0;            // number of frames this node has been waiting for the scheduler
+    bool m_released = false;        // graphics resources were released, see releaseGraphicsResources()
+    QQuickVtkFrameReadback m_readback;
+    std::atomic<bool> m_framesInFlight = false;     // m_readback isn't empty, written where we render
+    std::shared_ptr<QQuickVtkFrameEncoder> m_encoder;
+    QStringList m_captures;         // files waiting for the next frame, see QQuickVtkItem::capture()
+    bool m_recording = false;
+    QSGVtkRenderScheduler* m_scheduler = nullptr;
+    std::shared_ptr<QQuickVtkRenderThread> m_thread;    // threadedRendering, shared by our render group and affinity
+    quint64 m_threadSerial = 0;                         // the age of m_thread, see QSGVtkRenderScheduler::place()
+    bool m_misplaced = false;                           // we have to move to another worker and don't render until then
+    QQuickVtkTextureHandoff m_handoff;                  // the frames of m_thread
+    friend class QSGVtkRenderScheduler;
 
 protected:
     // variables set in QQuickVtkItem::updatePaintNode()
     QQuickWindow* m_window = nullptr;
     QQuickItem* m_item = nullptr;
+    QPointer<QQuickItem> m_itemGuard;
     qreal m_devicePixelRatio = 0;
-    QSizeF size;
+    bool m_shareGraphicsResources = false;
+    int m_priority = 0;             // 2: interaction in flight, 1: focused, 0: others
+    bool m_suspended = false;       // not effectively visible, rendering is postponed until we are
+    int m_frameBudget = 0;
+    QString m_renderGroup;
+    QString m_renderAffinity;
+    QSize size;         // the visible part of the VTK framebuffer, in pixels
+    QSize allocated;    // the size the VTK framebuffer is allocated with, including headroom
     friend class QQuickVtkItem;
 };
 
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+QMutex QSGVtkRenderScheduler::s_mutex;
+QHash<QQuickWindow*, QSGVtkRenderScheduler*> QSGVtkRenderScheduler::s_schedulers;
+
+QSGVtkRenderScheduler::QSGVtkRenderScheduler(QQuickWindow* window) : m_window(window)
+{
+    connect(window, &QQuickWindow::beforeRendering, this, &QSGVtkRenderScheduler::render, Qt::DirectConnection);
+    connect(window, &QQuickWindow::afterFrameEnd, this, &QSGVtkRenderScheduler::frameEnded, Qt::DirectConnection);
+}
+
+QSGVtkRenderScheduler::~QSGVtkRenderScheduler()
+{
+    for (auto const& pooled : std::as_const(m_pool))
+        pooled.window->ReleaseGraphicsResources(pooled.window);
+}
+
+vtkSmartPointer<vtkGenericOpenGLRenderWindow> QSGVtkRenderScheduler::createWindow(bool shareGraphicsResources)
+{
+    QQuickVtkTrace::Scope trace("createWindow");
+
+    // Loads the shader programs it has linked before from disk, see QQuickVtkShaderCache
+    vtkSmartPointer<vtkGenericOpenGLRenderWindow> window = vtkSmartPointer<QQuickVtkRenderWindow>::New();
+    window->SetMultiSamples(0);
+    window->SetReadyForRendering(false);
+    window->SetFrameBlitModeToNoBlit();
+    if (shareGraphicsResources)
+        window->SetSharedRenderWindow(sharedRenderWindow(QOpenGLContext::currentContext()));
+    vtkNew<QVTKInteractor> iren;
+    iren->SetRenderWindow(window);
+    vtkNew<vtkInteractorStyleTrackballCamera> style;
+    iren->SetInteractorStyle(style);
+    iren->Initialize();
+    window->SetMapped(true);
+    window->SetIsCurrent(true);
+    window->SetForceMaximumHardwareLineWidth(1);
+    window->SetOwnContext(false);
+    window->OpenGLInitContext();
+    return window;
+}
+
+// Renders a typical scene (a lit, gradient backed surface) once, so the window's shader cache already holds the
+// programs a node will need
+void QSGVtkRenderScheduler::warm(vtkGenericOpenGLRenderWindow* window)
+{
+    QQuickVtkTrace::Scope trace("warm");
+
+    vtkNew<vtkSphereSource> sphere;
+    vtkNew<vtkPolyDataMapper> mapper;
+    mapper->SetInputConnection(sphere->GetOutputPort());
+    vtkNew<vtkActor> actor;
+    actor->SetMapper(mapper);
+    vtkNew<vtkRenderer> renderer;
+    renderer->AddActor(actor);
+    renderer->SetGradientBackground(true);
+    window->AddRenderer(renderer);
+    window->SetSize(64, 64);
+
+    const bool needsWrap = QSGRendererInterface::isApiRhiBased(m_window->rendererInterface()->graphicsApi());
+    if (needsWrap)
+        m_window->beginExternalCommands();
+
+    auto ostate = window->GetState();
+    ostate->Reset();
+    ostate->Push();
+    ostate->vtkglDepthFunc(GL_LEQUAL);
+    window->SetReadyForRendering(true);
+    window->Render();
+    window->SetReadyForRendering(false);
+    ostate->Pop();
+
+    if (needsWrap)
+        m_window->endExternalCommands();
+
+    renderer->ReleaseGraphicsResources(window);
+    window->RemoveRenderer(renderer);
+}
+
+vtkSmartPointer<vtkGenericOpenGLRenderWindow> QSGVtkRenderScheduler::takeWindow(bool shareGraphicsResources)
+{
+    m_lastShared = shareGraphicsResources;
+
+    // The pool is refilled in one of the next quiet frames
+    m_window->update();
+
+    for (int i = 0; i < m_pool.size(); ++i)
+        if (m_pool[i].shareGraphicsResources == shareGraphicsResources)
+            return m_pool.takeAt(i).window;
+
+    return createWindow(shareGraphicsResources);
+}
+
+bool QSGVtkRenderScheduler::recycle(vtkGenericOpenGLRenderWindow* window, bool shareGraphicsResources)
+{
+    if (m_pool.size() >= PoolSize)
+        return false;
+
+    // Strip what the node put in, keep the window's OpenGL state and caches
+    window->SetReadyForRendering(false);
+    while (auto* renderer = window->GetRenderers()->GetFirstRenderer())
+        window->RemoveRenderer(renderer);
+    if (auto* iren = window->GetInteractor()) {
+        iren->RemoveAllObservers();
+        vtkNew<vtkInteractorStyleTrackballCamera> style;
+        iren->SetInteractorStyle(style);
+    }
+
+    m_pool.append({ window, shareGraphicsResources });
+    return true;
+}
+
+static bool sharesKeys(QSGVtkObjectNode* node, QStringList const& keys)
+{
+    auto own = node->keys();
+    return std::any_of(own.cbegin(), own.cend(), [&keys](QString const& key) { return keys.contains(key); });
+}
+
+std::shared_ptr<QQuickVtkRenderThread> QSGVtkRenderScheduler::renderThread(QSGVtkObjectNode* node, std::shared_ptr<QOffscreenSurface> surface)
+{
+    // Nodes sharing VTK objects (their render group's, or the data of their render affinity) have to render on the
+    // same thread. Joining the oldest worker of those merges their workers one by one, see place().
+    auto keys = node->keys();
+    QSGVtkObjectNode* oldest = nullptr;
+    for (auto* other : std::as_const(m_nodes)) {
+        if (other == node || !other->m_thread || other->m_misplaced || !sharesKeys(other, keys))
+            continue;
+        if (!oldest || other->m_threadSerial < oldest->m_threadSerial)
+            oldest = other;
+    }
+    if (oldest) {
+        node->m_threadSerial = oldest->m_threadSerial;
+        return oldest->m_thread;
+    }
+
+    auto thread = std::make_shared<QQuickVtkRenderThread>(std::move(surface));
+    if (!thread->isValid())
+        return {};
+
+    node->m_threadSerial = ++m_threadSerial;
+    return thread;
+}
+
+bool QSGVtkRenderScheduler::place(QSGVtkObjectNode* node)
+{
+    // The keys of a node change at its syncs (e.g. it shows another source), moving to the older worker is what
+    // makes the merging converge
+    bool placed = true;
+    auto keys = node->keys();
+    for (auto* other : std::as_const(m_nodes)) {
+        if (other == node || !other->m_thread || other->m_thread == node->m_thread || !sharesKeys(other, keys))
+            continue;
+
+        if (other->m_threadSerial < node->m_threadSerial) {
+            placed = false;
+        } else if (!other->m_misplaced) {
+            // Before we touch what it renders
+            other->m_thread->waitIdle();
+            other->m_misplaced = true;
+            other->requestSync();
+        }
+    }
+    return placed;
+}
+
+int QSGVtkRenderScheduler::spares() const
+{
+    return int(std::count_if(m_pool.cbegin(), m_pool.cend(), [this](Pooled const& p) { return p.shareGraphicsResources == m_lastShared; }));
+}
+
+// Keeps Spares warm windows of the kind last asked for
+void QSGVtkRenderScheduler::replenish()
+{
+    if (spares() >= Spares)
+        return;
+
+    auto window = createWindow(m_lastShared);
+    warm(window);
+    m_pool.append({ window, m_lastShared });
+}
+
+QSGVtkRenderScheduler* QSGVtkRenderScheduler::add(QQuickWindow* window, QSGVtkObjectNode* node)
+{
+    QMutexLocker lock(&s_mutex);
+
+    auto*& scheduler = s_schedulers[window];
+    if (!scheduler)
+        scheduler = new QSGVtkRenderScheduler(window);
+    scheduler->m_nodes.append(node);
+    return scheduler;
+}
+
+void QSGVtkRenderScheduler::remove(QSGVtkObjectNode* node)
+{
+    m_nodes.removeOne(node);
+    if (!m_nodes.isEmpty())
+        return;
+
+    QMutexLocker lock(&s_mutex);
+    s_schedulers.remove(m_window);
+    delete this;
+}
+
+void QSGVtkRenderScheduler::render()
+{
+    QQuickVtkTrace::Scope trace("schedule", m_window);
+
+    struct Batch
+    {
+        QList<QSGVtkObjectNode*> nodes;
+        int priority = 0;
+        int deferrals = 0;
+        double cost = 0;
+    };
+
+    for (auto* node : std::as_const(m_nodes))
+        node->collectFrames();
+
+    QList<Batch> pending;
+    QHash<QString, int> groups;
+    int budget = std::numeric_limits<int>::max();
+    for (auto* node : std::as_const(m_nodes)) {
+        budget = qMin(budget, node->m_frameBudget);
+
+        // Hidden nodes stay pending, they render once when they show up again. So do nodes about to move to
+        // another worker, they render once they're there.
+        if (node->m_suspended || node->isBlocked() || node->m_misplaced)
+            continue;
+
+        Batch* batch = nullptr;
+        if (node->m_renderGroup.isEmpty()) {
+            if (!node->m_renderPending)
+                continue;
+            batch = &pending.emplace_back();
+        } else {
+            if (!groups.contains(node->m_renderGroup)) {
+                groups.insert(node->m_renderGroup, pending.size());
+                pending.emplace_back();
+            }
+            batch = &pending[groups.value(node->m_renderGroup)];
+        }
+
+        batch->nodes.append(node);
+        if (node->m_renderPending) {
+            batch->priority = qMax(batch->priority, node->m_priority);
+            batch->deferrals = qMax(batch->deferrals, node->m_deferrals);
+        }
+        // Nodes rendering on a worker cost us nothing
+        if (!node->m_thread)
+            batch->cost += node->m_cost;
+    }
+
+    // Groups none of whose members is pending
+    pending.removeIf([](Batch const& b) {
+        return std::none_of(b.nodes.cbegin(), b.nodes.cend(), [](QSGVtkObjectNode* n) { return n->m_renderPending; });
+        });
+
+    // A quiet frame, warm up a spare window for the next node
+    if (pending.isEmpty()) {
+        replenish();
+        return;
+    }
+
+    std::stable_sort(pending.begin(), pending.end(), [](Batch const& a, Batch const& b) {
+        return a.priority != b.priority ? a.priority > b.priority : a.deferrals > b.deferrals;
+        });
+
+    QElapsedTimer frame;
+    frame.start();
+
+    bool deferred = false;
+    for (auto& batch : pending) {
+        auto spent = frame.nsecsElapsed() / 1e6;
+        bool mustRender = batch.priority > 0 || batch.deferrals >= MaxDeferrals || &batch == &pending.first();
+        if (!mustRender && spent + batch.cost > budget) {
+            for (auto* node : std::as_const(batch.nodes))
+                if (node->m_renderPending)
+                    ++node->m_deferrals;
+            deferred = true;
+            continue;
+        }
+
+        for (auto* node : std::as_const(batch.nodes)) {
+            node->m_deferrals = 0;
+            node->m_renderPending = true;
+            node->render();
+        }
+    }
+
+    // Come back for the deferred nodes in the next frame, or for a quiet one to warm up a spare window
+    if (deferred || spares() < Spares)
+        m_window->update();
+}
+
+// The scene graph submitted its frame, fence the textures it sampled from our workers
+void QSGVtkRenderScheduler::frameEnded()
+{
+    for (auto* node : std::as_const(m_nodes))
+        if (node->m_thread)
+            node->m_handoff.rendered();
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
 QSGNode* QQuickVtkItem::updatePaintNode(QSGNode* node, UpdatePaintNodeData*)
 {
     auto* n = static_cast<QSGVtkObjectNode*>(node);
-    
+
+    QQuickVtkTrace::Scope trace("updatePaintNode", this);
+
     // Don't create the node if our size is invalid
     if (!n && (width() <= 0 || height() <= 0))
         return nullptr;
@@ -242,55 +1422,191 @@ QSGNode* QQuickVtkItem::updatePaintNode(QSGNode* node, UpdatePaintNodeData*)
         n = d->node;
     }
         
+    // A threaded node rendering what nodes of another worker render moves there, by recreating it. The pipeline (and
+    // with it everything the node showed) survives, see initializePipeline().
+    if (n->m_item && n->m_thread) {
+        n->m_renderGroup = d->renderGroup;
+        n->m_renderAffinity = d->renderAffinity;
+        if (n->m_misplaced || !n->m_scheduler->place(n)) {
+            QQuickVtkTrace::Scope trace("moveWorker", this);
+            delete n;
+            n = d->node = new QSGVtkObjectNode;
+        }
+    }
+
     // Initialize the QSGRenderNode
     if (!n->m_item) {
-        n->initialize(this);
+        if (!d->pipelineInitialized) {
+            d->pipelineInitialized = true;
+            d->pipeline = initializePipeline();
+        }
+        n->m_shareGraphicsResources = d->shareGraphicsResources;
         n->m_window = window();
         n->m_item = this;
-        connect(window(), &QQuickWindow::beforeRendering, n, &QSGVtkObjectNode::render);
+        n->m_itemGuard = this;
+        n->m_renderGroup = d->renderGroup;
+        n->m_renderAffinity = d->renderAffinity;
+        n->m_scheduler = QSGVtkRenderScheduler::add(window(), n);
+        n->initialize(this, d->threadedRendering ? d->surface : nullptr);
+        if (n->m_thread)
+            n->m_scheduler->place(n);
         connect(window(), &QQuickWindow::screenChanged, n, &QSGVtkObjectNode::handleScreenChange);
     }
 
+    // Our worker may still be rendering. Then we only show the frames it finished, it has us synced again once
+    // it's done and everything else waits for that sync.
+    if (!n->isIdle()) {
+        n->showFrame();
+        n->setRect(0, 0, width(), height());
+        return n;
+    }
+
+    // Suspend rendering while nobody can see us and, after releaseDelay, free our graphics memory
+    bool visible = d->effectivelyVisible();
+    n->m_suspended = !visible;
+    if (!visible && d->releaseGraphics && !n->m_released)
+        n->releaseGraphicsResources();
+
+    // Tell the scheduler how urgent we are
+    n->m_priority = d->interacting ? 2 : hasActiveFocus() || hasFocus() ? 1 : 0;
+    n->m_frameBudget = d->frameBudget;
+    n->m_renderGroup = d->renderGroup;
+    n->m_renderAffinity = d->renderAffinity;
+
     // Watch for size changes
+    //
+    // The VTK framebuffer is allocated with headroom (+25%, rounded up to 64 pixels) and we render into its
+    // bottom-left corner. Any size change that still fits is just a viewport change and an ordinary (async) render.
+    // A size change that doesn't fit needs a new framebuffer, but while the user is still resizing we keep showing
+    // the previous frame stretched over our new geometry and only reallocate once the resizing settled.
+    //
+    // With adaptiveQuality we render an even smaller part of the framebuffer while interacting; the texture node
+    // upscales it to our full geometry.
     n->m_devicePixelRatio = window()->devicePixelRatio();
-    auto sz = size() * n->m_devicePixelRatio;
-    bool dirtySize = sz != n->size; 
+    auto full = (size() * n->m_devicePixelRatio).toSize().expandedTo({ 1, 1 });
+    auto bucket = [](int x) { return (x + x / 4 + 63) / 64 * 64; };
+    QSize bucketed(bucket(full.width()), bucket(full.height()));
+    bool fits = full.width() <= n->allocated.width() && full.height() <= n->allocated.height();
+    bool oversized = n->allocated.width() * n->allocated.height() > 2 * bucketed.width() * bucketed.height();
+
+    bool dirtySize = fits
+        ? oversized && !d->resizing
+        : !d->resizing || !n->texture() || n->m_released;
+    if (n->m_released && !visible)
+        dirtySize = false;
+    QElapsedTimer rebuild;
+    auto rebuildBegin = QQuickVtkTrace::enabled() ? QQuickVtkTrace::now() : 0;
     if (dirtySize) {
-        n->vtkWindow->SetSize(sz.width(), sz.height());
-        n->vtkWindow->GetInteractor()->SetSize(n->vtkWindow->GetSize());
-        delete n->texture();
+        rebuild.start();
+        n->m_released = false;
+        n->allocated = bucketed;
+        n->exec([n] { n->vtkWindow->SetSize(n->allocated.width(), n->allocated.height()); });
+        if (!n->m_thread)
+            delete n->texture();
+    }
+
+    // Every render time adapts the scale once, syncs without a render in between (e.g. a resize) would otherwise
+    // compound the same correction
+    auto renderScale = d->renderScale;
+    bool sampled = std::exchange(d->renderScaleSample, n->m_renderCount) != n->m_renderCount;
+    d->updateRenderScale(sampled ? n->m_lastRenderTime : 0);
+    auto sz = (QSizeF(full) * d->renderScale).toSize().expandedTo({ 1, 1 });
+    d->qt2vtkInteractorAdapter.SetDevicePixelRatio(n->m_devicePixelRatio * d->renderScale);
+
+    if (dirtySize || (fits && sz != n->size)) {
         n->size = sz;
+        n->exec([n, k = d->renderScale / renderScale] {
+            // Keep the interactor's notion of the last event position in the new scale, or the interactor style
+            // sees a jump the next time the mouse moves
+            if (k != 1) {
+                auto* iren = n->vtkWindow->GetInteractor();
+                auto* pos = iren->GetEventPosition();
+                iren->SetEventPosition(int(pos[0] * k), int(pos[1] * k));
+            }
+
+            n->setViewportScale({ double(n->size.width()) / n->allocated.width(), double(n->size.height()) / n->allocated.height() });
+            n->vtkWindow->GetInteractor()->SetSize(n->size.width(), n->size.height());
+        });
+        n->scheduleRender();
     }
 
+    // Frame export, see capture() and startRecording()
+    n->m_encoder = d->encoder;
+    n->m_captures += std::exchange(d->captures, {});
+    n->m_recording = recording();
+    if (!n->m_captures.isEmpty() || n->m_recording)
+        n->scheduleRender();
+
+    // A stopped recording ends once the frames read back before are written, see collect()
+    if (n->m_encoder && n->m_encoder->stopping())
+        n->exec([n] {
+            if (n->m_readback.isEmpty())
+                n->m_encoder->finishRecording();
+        });
+
     // Dispatch commands to VTK
-    if (d->asyncDispatch.size()) {
+    d->stats.queueLength = d->asyncDispatch.size();
+    QQuickVtkTrace::counter("queue", d->stats.queueLength, this);
+    if (!d->asyncDispatch.isEmpty()) {
+        QQuickVtkTrace::Scope trace("dispatch", this);
+        QElapsedTimer timer;
+        timer.start();
+
         n->scheduleRender();
+        n->m_inputPending |= std::exchange(d->inputPending, false);
 
-        n->vtkWindow->SetReadyForRendering(true);
-        while (d->asyncDispatch.size())
-            d->asyncDispatch.dequeue()(n->vtkWindow, n->vtkUserData);
-        n->vtkWindow->SetReadyForRendering(false);
-    }
+        n->exec([n, d] {
+            n->vtkWindow->SetReadyForRendering(true);
+            d->asyncDispatch.replay(d->qt2vtkInteractorAdapter, n->vtkWindow, n->vtkUserData);
+            n->vtkWindow->SetReadyForRendering(false);
+        });
+
+        d->stats.dispatchTime = timer.nsecsElapsed() / 1e6;
+    } else
+        d->stats.dispatchTime = 0;
     
-    // Whenever the size changes we need to get a new FBO from VTK so we need to render right now (with the gui-thread blocked) for this one frame.
-    if (dirtySize) {
+    // Whenever the allocation changes we need to get a new FBO from VTK so we need to render right now (with the gui-thread blocked) for this one frame.
+    if (dirtySize && n->m_thread) {
+        n->exec([n] {
+            n->renderVtk();
+            n->m_handoff.publish(n->vtkWindow, n->allocated, n->size);
+        });
+
+        d->stats.rebuildTime = rebuild.nsecsElapsed() / 1e6;
+        ++d->stats.rebuildCount;
+        QQuickVtkTrace::complete("rebuild", rebuildBegin, this);
+    } else if (dirtySize) {
         n->scheduleRender();
         n->render();
         if (auto fb = n->vtkWindow->GetDisplayFramebuffer(); fb && fb->GetNumberOfColorAttachments() > 0) {
             GLuint texId = fb->GetColorAttachmentAsTextureObject(0)->GetHandle();
 #if QT_VERSION < QT_VERSION_CHECK(6,0,0)
-            auto *texture = window()->createTextureFromNativeObject(QQuickWindow::NativeObjectTexture, &texId, 0, sz.toSize(), QQuickWindow::TextureHasAlphaChannel);
+            auto *texture = window()->createTextureFromNativeObject(QQuickWindow::NativeObjectTexture, &texId, 0, n->allocated, QQuickWindow::TextureHasAlphaChannel);
 #else
-            auto *texture = QNativeInterface::QSGOpenGLTexture::fromNative(texId, window(), sz.toSize(), QQuickWindow::TextureHasAlphaChannel);
+            auto *texture = QNativeInterface::QSGOpenGLTexture::fromNative(texId, window(), n->allocated, QQuickWindow::TextureHasAlphaChannel);
 #endif
             n->setTexture(texture);
+            n->setSourceRect(0, 0, n->size.width(), n->size.height());
         } else if (!fb)
             qWarning().nospace() << "QQuickVTKItem.cpp:" << __LINE__ << ", YIKES!!, Render() didn't create a FrameBuffer!?";
         else
             qWarning().nospace() << "QQuickVTKItem.cpp:" << __LINE__ << ", YIKES!!, Render() didn't create any ColorBufferAttachements to its FrameBuffer!?";
 
+        d->stats.rebuildTime = rebuild.nsecsElapsed() / 1e6;
+        ++d->stats.rebuildCount;
+        QQuickVtkTrace::complete("rebuild", rebuildBegin, this);
     }
 
+    // The frame our worker rendered since the last sync
+    if (n->m_thread)
+        n->showFrame();
+
+    // The render thread's share of the previous frame
+    d->stats.processEventsTime = n->m_processEventsTime;
+    d->stats.renderTime = n->m_renderTime;
+    d->stats.droppedFrames = d->encoder ? d->encoder->dropped() : 0;
+    d->publishStats();
+
     n->setTextureCoordinatesTransform(QSGSimpleTextureNode::MirrorVertically);
     n->setFiltering(smooth() ? QSGTexture::Linear : QSGTexture::Nearest);
     n->setRect(0, 0, width(), height());
@@ -305,6 +1621,50 @@ QSGNode* QQuickVtkItem::updatePaintNode(QSGNode* node, UpdatePaintNodeData*)
     return n;
 }
 
+void QQuickVtkItem::geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+
+    Q_D(QQuickVtkItem);
+
+    if (newGeometry.size() != oldGeometry.size()) {
+        d->resizing = true;
+        d->resizeSettle.start();
+    }
+
+    d->updateVisibility();
+}
+
+void QQuickVtkItem::itemChange(ItemChange change, const ItemChangeData& value)
+{
+    QQuickItem::itemChange(change, value);
+
+    switch (change)
+    {
+    case ItemSceneChange:
+    case ItemParentHasChanged:
+    case ItemVisibleHasChanged:
+    case ItemOpacityHasChanged:
+    {
+        Q_D(QQuickVtkItem);
+        if (change == ItemSceneChange || change == ItemParentHasChanged)
+            d->watchAncestors();
+        d->updateVisibility();
+        if (change == ItemSceneChange)
+            d->createSurface();
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+QQuickVtkItem::vtkUserData QQuickVtkItem::pipeline() const
+{
+    Q_D(const QQuickVtkItem);
+    return d->pipeline;
+}
+
 void QQuickVtkItem::scheduleRender()
 {
     Q_D(QQuickVtkItem);
@@ -367,6 +1727,8 @@ bool QQuickVtkItem::event(QEvent * ev)
 {
     Q_D(QQuickVtkItem);
 
+    QQuickVtkTrace::Scope trace("event", this);
+
     if (!ev)
         return false;
 #if QT_VERSION < QT_VERSION_CHECK(6,0,0)
@@ -578,13 +1940,32 @@ bool QQuickVtkItem::event(QEvent * ev)
         return QQuickItem::event(ev);
     }
 #else
-    dispatch_async([d, e = ev->clone()]
-                   (vtkRenderWindow* vtkWindow, vtkUserData) mutable {
-                       d->qt2vtkInteractorAdapter.ProcessEvent(e, vtkWindow->GetInteractor());
-                       delete e;
-                   });
+    // Input events are copied by value into the command buffer (moves and wheel steps are merged there), every
+    // other event is none of VTK's business.
+    if (!d->asyncDispatch.push(ev))
+        return QQuickItem::event(ev);
 
+    switch (ev->type())
+    {
+    case QEvent::MouseButtonPress:
+        d->idle.stop();
+        d->setInteracting(true);
+        break;
+    case QEvent::MouseButtonRelease:
+        if (static_cast<QMouseEvent*>(ev)->buttons() == Qt::NoButton)
+            d->idle.start();
+        break;
+    case QEvent::Wheel:
+        d->setInteracting(true);
+        d->idle.start();
+        break;
+    default:
+        break;
+    }
+
+    update();
 #endif
+    d->inputPending = true;
     ev->accept();
 
     return true;
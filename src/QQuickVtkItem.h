@@ -23,6 +23,27 @@ class QQuickVtkItemPrivate;
 class QQuickVtkItem : public QQuickItem
 {
     Q_OBJECT
+    Q_PROPERTY(bool shareGraphicsResources READ shareGraphicsResources WRITE setShareGraphicsResources NOTIFY shareGraphicsResourcesChanged)
+    Q_PROPERTY(bool threadedRendering READ threadedRendering WRITE setThreadedRendering NOTIFY threadedRenderingChanged)
+    Q_PROPERTY(bool adaptiveQuality READ adaptiveQuality WRITE setAdaptiveQuality NOTIFY adaptiveQualityChanged)
+    Q_PROPERTY(int targetFrameTime READ targetFrameTime WRITE setTargetFrameTime NOTIFY targetFrameTimeChanged)
+    Q_PROPERTY(int idleDelay READ idleDelay WRITE setIdleDelay NOTIFY idleDelayChanged)
+    Q_PROPERTY(bool interacting READ interacting NOTIFY interactingChanged)
+    Q_PROPERTY(int frameBudget READ frameBudget WRITE setFrameBudget NOTIFY frameBudgetChanged)
+    Q_PROPERTY(QString renderGroup READ renderGroup WRITE setRenderGroup NOTIFY renderGroupChanged)
+    Q_PROPERTY(QString renderAffinity READ renderAffinity WRITE setRenderAffinity NOTIFY renderAffinityChanged)
+    Q_PROPERTY(int releaseDelay READ releaseDelay WRITE setReleaseDelay NOTIFY releaseDelayChanged)
+    Q_PROPERTY(bool recording READ recording NOTIFY recordingChanged)
+    Q_PROPERTY(int recordingMemoryLimit READ recordingMemoryLimit WRITE setRecordingMemoryLimit NOTIFY recordingMemoryLimitChanged)
+    Q_PROPERTY(double dispatchTime READ dispatchTime NOTIFY statsChanged)
+    Q_PROPERTY(double processEventsTime READ processEventsTime NOTIFY statsChanged)
+    Q_PROPERTY(double renderTime READ renderTime NOTIFY statsChanged)
+    Q_PROPERTY(double rebuildTime READ rebuildTime NOTIFY statsChanged)
+    Q_PROPERTY(int rebuildCount READ rebuildCount NOTIFY statsChanged)
+    Q_PROPERTY(int queueLength READ queueLength NOTIFY statsChanged)
+    Q_PROPERTY(int droppedFrames READ droppedFrames NOTIFY statsChanged)
+    Q_PROPERTY(int shaderCacheHits READ shaderCacheHits NOTIFY statsChanged)
+    Q_PROPERTY(int shaderCacheMisses READ shaderCacheMisses NOTIFY statsChanged)
 
 public:
     explicit QQuickVtkItem(QQuickItem* parent = nullptr);
@@ -55,6 +76,22 @@ public:
     */
     virtual vtkUserData initializeVTK(vtkRenderWindow *renderWindow) { Q_UNUSED(renderWindow) return {}; }
 
+    /**
+    * This is where the CPU side of the VTK pipeline should be created: sources, filters, computed data, cameras,
+    * i.e. everything that doesn't own graphics resources.
+    *
+    * \note The returned object is owned by the item, NOT by the underlying QSGNode. It survives the QSGNode being
+    *       deleted by the QML SceneGraph, so (re)creating the node only has to recreate the graphics side in
+    *       initializeVTK() and upload the already computed data again.
+    *
+    * \note This method is called once, on the QML render thread with the GUI thread blocked, just before the first
+    *       initializeVTK(). Its result can be retrieved with pipeline() from initializeVTK() and dispatch_async()
+    *       functions only.
+    *
+    * \return The vtkUserData object holding the CPU side of the pipeline
+    */
+    virtual vtkUserData initializePipeline() { return {}; }
+
     /**
     * This is the function that enqueues an async command that will be executed just before VTK renders
     * 
@@ -71,14 +108,181 @@ public:
     */
     void dispatch_async(std::function<void(vtkRenderWindow* renderWindow, vtkUserData userData)>);
 
+    /**
+    * When enabled, the VTK render window of this item shares its vertex buffer cache with every other sharing
+    * VTK render window whose OpenGL context is in the same share group (e.g. all items of one QQuickWindow).
+    * Mappers fed with the same vtkDataArrays (see GeometryCache) then upload their buffers to the GPU only once.
+    *
+    * \note Only taken into account when the underlying QSGNode is (re)created.
+    */
+    bool shareGraphicsResources() const;
+    void setShareGraphicsResources(bool);
+
+    /**
+    * When enabled, all VTK code of this item (initializeVTK(), the dispatch_async() functions and rendering) runs
+    * on a worker thread with an OpenGL context of its own, shared with the scene graph's, instead of on the QML
+    * render thread. Items of the same renderGroup or renderAffinity share one worker, every other item has its
+    * own, so several items render at the same time. Each frame is copied into a chain of three textures (see
+    * QQuickVtkTextureHandoff): the scene graph always samples the newest completed frame, so a slow item merely
+    * misses frames of the window and never holds up the others or the UI.
+    *
+    * The GUI thread is still blocked while initializeVTK() and the dispatch_async() functions run. A sync which
+    * finds the worker rendering only picks up its finished frames and leaves the rest to the next sync.
+    *
+    * \note Only taken into account when the underlying QSGNode is (re)created. shareGraphicsResources is ignored
+    *       while enabled, VTK objects can't be shared across threads: items rendering the same VTK objects have
+    *       to say so with renderAffinity.
+    */
+    bool threadedRendering() const;
+    void setThreadedRendering(bool);
+
+    /**
+    * When enabled, the item renders at a reduced internal resolution while the user is interacting with it
+    * (a mouse button is down or the wheel is spinning) and the scene graph upscales the result. The resolution is
+    * adapted from the measured render time so that a frame takes about targetFrameTime milliseconds.
+    *
+    * Once no input arrived for idleDelay milliseconds, interacting turns false and one full resolution frame is rendered.
+    *
+    * \note Subclasses can react to interactingChanged() to swap in cheaper representations (e.g. a decimated mesh)
+    */
+    bool adaptiveQuality() const;
+    void setAdaptiveQuality(bool);
+
+    int targetFrameTime() const;
+    void setTargetFrameTime(int);
+
+    int idleDelay() const;
+    void setIdleDelay(int);
+
+    bool interacting() const;
+
+    /**
+    * All VTK items of a window are rendered by one scheduler which keeps the time spent rendering VTK below
+    * frameBudget milliseconds per frame (the smallest value of all items of the window is used).
+    *
+    * Items with interaction in flight and the focused item are always rendered, the others are deferred to one
+    * of the next frames when the budget is exhausted.
+    */
+    int frameBudget() const;
+    void setFrameBudget(int);
+
+    /**
+    * Items of a window with the same (non empty) renderGroup are rendered together: as soon as one of them has to
+    * render, all of them render, in the same beforeRendering pass. The scheduler never defers part of a group.
+    *
+    * Use it for items sharing VTK state (e.g. one vtkCamera), so a change made through one of them shows up in all
+    * of them in the same frame without dispatching a command to each of them.
+    */
+    QString renderGroup() const;
+    void setRenderGroup(QString const&);
+
+    /**
+    * With threadedRendering, items of a window with the same (non empty) renderAffinity render on the same worker,
+    * as do the items of a renderGroup. Set it to a key of the VTK objects the item renders which other items may
+    * render too, e.g. a vtkPolyData shared through a cache, so no two threads ever render them at once.
+    *
+    * Workers are merged as needed: an item sharing a renderGroup or renderAffinity with items of another worker
+    * moves to the older of the two, by recreating its QSGNode (initializeVTK() runs again) at its next sync.
+    * Until then it doesn't render.
+    */
+    QString renderAffinity() const;
+    void setRenderAffinity(QString const&);
+
+    /**
+    * While the item isn't effectively visible (invisible, transparent, less than a pixel in size or clipped away
+    * by its ancestors) it doesn't render. Commands passed to dispatch_async() are still executed. Its ancestors'
+    * visibility, opacity, clipping and geometry are watched as well as its own.
+    *
+    * After releaseDelay milliseconds of not being visible the VTK framebuffers and all other graphics resources
+    * are released; the VTK pipeline (the vtkUserData) is kept. When the item shows up again it reallocates them
+    * and renders once. A negative value never releases.
+    */
+    int releaseDelay() const;
+    void setReleaseDelay(int);
+
+    /**
+    * Saves the next frame this item renders to fileName, in the format given by its suffix (e.g. .png), and emits
+    * captured() once it's written. The frame is read back asynchronously (see QQuickVtkFrameReadback) and encoded
+    * on a worker thread, so neither the render thread nor the GUI thread wait for it.
+    *
+    * \note Nothing is captured while the item isn't effectively visible, see releaseDelay.
+    */
+    Q_INVOKABLE void capture(QString const& fileName);
+
+    /**
+    * Records every frame of the window to fileName until stopRecording(): the item renders in every frame of the
+    * window while recording. If fileName contains "%1" the frames are saved as an image sequence (%1 is the
+    * frame number), otherwise they are written to a raw video file, see QQuickVtkFrameEncoder.
+    *
+    * Frames waiting to be encoded take at most recordingMemoryLimit MiB, the frames which don't fit are dropped
+    * and counted in droppedFrames. Returns false if fileName can't be written.
+    */
+    Q_INVOKABLE bool startRecording(QString const& fileName);
+    Q_INVOKABLE void stopRecording();
+    bool recording() const;
+
+    int recordingMemoryLimit() const;
+    void setRecordingMemoryLimit(int);
+
+    /**
+    * Where the time of this item's last frames went, in milliseconds, e.g. for an on-screen overlay:
+    *
+    *   dispatchTime:      replaying the dispatch_async() commands and input events in updatePaintNode()
+    *   processEventsTime: the interactor's ProcessEvents()
+    *   renderTime:        VTK's Render()
+    *   rebuildTime:       the last reallocation of the VTK framebuffer and its texture (rebuildCount in total)
+    *   queueLength:       the number of commands replayed in the last updatePaintNode()
+    *   droppedFrames:     the frames of the current recording which were dropped, see startRecording()
+    *   shaderCacheHits:   the shader programs of all items loaded from disk, see QQuickVtkShaderCache
+    *   shaderCacheMisses: the shader programs of all items compiled (and stored to disk)
+    *
+    * \note statsChanged() is emitted at most four times a second. The timings of the render thread are picked
+    *       up at the next sync, so they lag one frame behind.
+    *
+    * \note Set the QQUICKVTK_TRACE environment variable to a file path to also record these stages (and the
+    *       GUI thread's event handling) of every frame as a Chrome trace, see QQuickVtkTrace.
+    */
+    double dispatchTime() const;
+    double processEventsTime() const;
+    double renderTime() const;
+    double rebuildTime() const;
+    int rebuildCount() const;
+    int queueLength() const;
+    int droppedFrames() const;
+    int shaderCacheHits() const;
+    int shaderCacheMisses() const;
+
+Q_SIGNALS:
+    void shareGraphicsResourcesChanged(bool);
+    void threadedRenderingChanged(bool);
+    void adaptiveQualityChanged(bool);
+    void targetFrameTimeChanged(int);
+    void idleDelayChanged(int);
+    void interactingChanged(bool);
+    void frameBudgetChanged(int);
+    void renderGroupChanged(QString);
+    void renderAffinityChanged(QString);
+    void releaseDelayChanged(int);
+    void recordingChanged(bool);
+    void recordingMemoryLimitChanged(int);
+    void captured(QString fileName, bool ok);
+    void statsChanged();
+
 protected:
     void scheduleRender();
 
+    /**
+    * The object returned from initializePipeline(). Only to be used on the QML render thread.
+    */
+    vtkUserData pipeline() const;
+
 protected:
     bool event(QEvent*) override;
 
 protected:
     QSGNode* updatePaintNode(QSGNode*, UpdatePaintNodeData*) override;
+    void geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) override;
+    void itemChange(ItemChange change, const ItemChangeData& value) override;
     bool isTextureProvider() const override;
     QSGTextureProvider* textureProvider() const override;
     void releaseResources() override;
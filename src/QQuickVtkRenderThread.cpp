@@ -0,0 +1,234 @@
+#include "QQuickVtkRenderThread.h"
+#include "QQuickVtkTrace.h"
+
+#include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
+#include <QtGui/QOffscreenSurface>
+#include <QtGui/QOpenGLContext>
+
+#include <vtk_glew.h>
+#include <vtkOpenGLFramebufferObject.h>
+#include <vtkOpenGLRenderWindow.h>
+#include <vtkOpenGLState.h>
+
+#include <algorithm>
+#include <utility>
+
+QQuickVtkRenderThread::QQuickVtkRenderThread(std::shared_ptr<QOffscreenSurface> surface) : m_surface(std::move(surface))
+{
+    auto* shared = QOpenGLContext::currentContext();
+    if (!shared) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! No OpenGL context is current, there is nothing to share with";
+        return;
+    }
+    if (!m_surface || !m_surface->isValid()) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! The offscreen surface is missing or invalid";
+        return;
+    }
+
+    auto* context = new QOpenGLContext;
+    context->setFormat(shared->format());
+    context->setShareContext(shared);
+    context->setScreen(shared->screen());
+    if (!context->create()) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! Creating a shared OpenGL context failed";
+        delete context;
+        return;
+    }
+
+    // The context is made current, used and deleted by run()
+    m_context = context;
+    m_context->moveToThread(this);
+    setObjectName("QQuickVtkRenderThread");
+    start();
+}
+
+QQuickVtkRenderThread::~QQuickVtkRenderThread()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_quit = true;
+        m_wake.wakeOne();
+    }
+    wait();
+}
+
+void QQuickVtkRenderThread::post(std::function<void()> job)
+{
+    QMutexLocker lock(&m_mutex);
+    m_jobs.enqueue(std::move(job));
+    m_wake.wakeOne();
+}
+
+void QQuickVtkRenderThread::exec(std::function<void()> job)
+{
+    post(std::move(job));
+    waitIdle();
+}
+
+void QQuickVtkRenderThread::waitIdle()
+{
+    QQuickVtkTrace::Scope trace("waitIdle");
+
+    QMutexLocker lock(&m_mutex);
+    while (m_busy || !m_jobs.isEmpty())
+        m_idle.wait(&m_mutex);
+}
+
+bool QQuickVtkRenderThread::isIdle()
+{
+    QMutexLocker lock(&m_mutex);
+    return !m_busy && m_jobs.isEmpty();
+}
+
+void QQuickVtkRenderThread::run()
+{
+    if (!m_context->makeCurrent(m_surface.get()))
+        qWarning() << Q_FUNC_INFO << "YIKES!! Making the worker's OpenGL context current failed";
+
+    QMutexLocker lock(&m_mutex);
+    for (;;) {
+        while (m_jobs.isEmpty() && !m_quit)
+            m_wake.wait(&m_mutex);
+        if (m_jobs.isEmpty())
+            break;
+
+        auto job = m_jobs.dequeue();
+        m_busy = true;
+        lock.unlock();
+        job();
+        lock.relock();
+        m_busy = false;
+
+        if (m_jobs.isEmpty())
+            m_idle.wakeAll();
+    }
+    lock.unlock();
+
+    m_context->doneCurrent();
+    delete m_context;
+    m_context = nullptr;
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+QQuickVtkTextureHandoff::~QQuickVtkTextureHandoff()
+{
+    if (m_fbo || std::any_of(m_textures.cbegin(), m_textures.cend(), [](Texture const& t) { return t.id; }))
+        qWarning() << Q_FUNC_INFO << "YIKES!! Textures leaked, release() wasn't called";
+}
+
+void QQuickVtkTextureHandoff::publish(vtkOpenGLRenderWindow* window, QSize const& allocated, QSize const& size)
+{
+    auto* fb = window->GetDisplayFramebuffer();
+    if (!fb || size.isEmpty())
+        return;
+
+    QQuickVtkTrace::Scope trace("publish");
+
+    // Neither front nor waiting, the render thread never touches it until we publish it
+    int write = 0;
+    void* sampled = nullptr;
+    {
+        QMutexLocker lock(&m_mutex);
+        while (write == m_front || write == m_ready)
+            ++write;
+        sampled = std::exchange(m_textures[write].sampled, nullptr);
+    }
+    auto& texture = m_textures[write];
+
+    // The scene graph may still be sampling it from when it was the front texture
+    if (sampled) {
+        glWaitSync(GLsync(sampled), 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(GLsync(sampled));
+    }
+
+    if (!texture.id)
+        glGenTextures(1, &texture.id);
+    if (texture.allocated != allocated) {
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, allocated.width(), allocated.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        texture.allocated = allocated;
+    }
+
+    // Through VTK's state cache, so VTK doesn't lose track of the bindings
+    auto* state = window->GetState();
+    state->Push();
+    state->PushFramebufferBindings();
+    if (!m_fbo)
+        glGenFramebuffers(1, &m_fbo);
+    state->vtkglBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture.id, 0);
+    fb->Bind(GL_READ_FRAMEBUFFER);
+    fb->ActivateReadBuffer(0);
+    state->vtkglDisable(GL_SCISSOR_TEST);
+    state->vtkglBlitFramebuffer(0, 0, size.width(), size.height(), 0, 0, size.width(), size.height(), GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    state->PopFramebufferBindings();
+    state->Pop();
+
+    texture.size = size;
+    auto* written = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    // Make sure the fence reaches the GPU before the render thread waits for it
+    glFlush();
+
+    // Replace the frame still waiting for a sync, it will never be shown
+    QMutexLocker lock(&m_mutex);
+    if (m_ready >= 0 && m_textures[m_ready].written) {
+        glDeleteSync(GLsync(m_textures[m_ready].written));
+        m_textures[m_ready].written = nullptr;
+    }
+    texture.written = written;
+    m_ready = write;
+}
+
+bool QQuickVtkTextureHandoff::acquire()
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_ready < 0)
+        return false;
+
+    // The GPU, not us, waits for the copy to finish
+    auto& ready = m_textures[m_ready];
+    glWaitSync(GLsync(ready.written), 0, GL_TIMEOUT_IGNORED);
+    glDeleteSync(GLsync(ready.written));
+    ready.written = nullptr;
+    m_front = std::exchange(m_ready, -1);
+    return true;
+}
+
+void QQuickVtkTextureHandoff::rendered()
+{
+    QMutexLocker lock(&m_mutex);
+    auto& front = m_textures[m_front];
+    if (!front.id)
+        return;
+
+    if (front.sampled)
+        glDeleteSync(GLsync(front.sampled));
+    front.sampled = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+}
+
+void QQuickVtkTextureHandoff::release()
+{
+    QMutexLocker lock(&m_mutex);
+    for (auto& texture : m_textures) {
+        if (texture.written)
+            glDeleteSync(GLsync(texture.written));
+        if (texture.sampled)
+            glDeleteSync(GLsync(texture.sampled));
+        if (texture.id)
+            glDeleteTextures(1, &texture.id);
+        texture = {};
+    }
+    if (m_fbo)
+        glDeleteFramebuffers(1, &m_fbo);
+    m_fbo = 0;
+    m_ready = -1;
+}
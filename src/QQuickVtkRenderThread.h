@@ -0,0 +1,129 @@
+#pragma once
+
+#include <QtCore/QMutex>
+#include <QtCore/QQueue>
+#include <QtCore/QSize>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+#include <array>
+#include <functional>
+#include <memory>
+
+class QOffscreenSurface;
+class QOpenGLContext;
+class vtkOpenGLRenderWindow;
+
+/**
+* A worker thread with an OpenGL context of its own, in the share group of the scene graph's context, on which a
+* QQuickVtkItem with threadedRendering runs all of its VTK code: creating the VTK window, replaying the
+* dispatch_async() commands and rendering. Several items thus render at the same time, each on its own core.
+*
+* Jobs run in the order they were posted. The render thread posts a frame and carries on; it only touches the
+* item's VTK objects again at a sync which finds the worker idle, so VTK is never used by two threads at once.
+* Items of one renderGroup share their VTK state and hence one worker.
+*
+* \note Create and destroy on the qml-render-thread with the scene graph's context current. The surface must have
+*       been created on the GUI thread, the thread shares its ownership.
+*/
+class QQuickVtkRenderThread : public QThread
+{
+public:
+    explicit QQuickVtkRenderThread(std::shared_ptr<QOffscreenSurface> surface);
+    ~QQuickVtkRenderThread() override;
+
+    // Whether the context could be created, otherwise no job ever runs
+    bool isValid() const { return m_context != nullptr; }
+
+    // Queues a job and returns
+    void post(std::function<void()> job);
+
+    // Queues a job and waits until it (and every job before it) ran
+    void exec(std::function<void()> job);
+
+    // Waits until every job posted so far ran
+    void waitIdle();
+
+    // Whether every job posted so far ran
+    bool isIdle();
+
+protected:
+    void run() override;
+
+private:
+    std::shared_ptr<QOffscreenSurface> m_surface;
+    QOpenGLContext* m_context = nullptr;
+
+    QMutex m_mutex;
+    QWaitCondition m_wake;
+    QWaitCondition m_idle;
+    QQueue<std::function<void()>> m_jobs;
+    bool m_busy = false;
+    bool m_quit = false;
+};
+
+/**
+* Hands the frames rendered on a QQuickVtkRenderThread over to the scene graph through a chain of three textures:
+* the front texture the scene graph samples, the newest completed frame waiting for the next sync (if any) and the
+* one the worker copies its next frame into.
+*
+* The worker copies each finished frame into its texture and fences the copy; the texture then replaces the
+* waiting one, which is free to be written again. At the next sync the render thread makes the waiting texture the
+* front one, and the GPU waits for the copy's fence before the scene graph samples it. Once the scene graph
+* rendered a frame the front texture is fenced as well, and the worker waits for that fence before it overwrites
+* the texture again, so neither side ever sees a half written texture.
+*
+* Neither side ever waits for the other: the worker always has a texture to write, however long the scene graph
+* keeps sampling the front one, and a worker falling behind merely leaves the front texture in place for another
+* frame of the window.
+*/
+class QQuickVtkTextureHandoff
+{
+public:
+    enum { Textures = 3 };
+
+    ~QQuickVtkTextureHandoff();
+
+    /**
+    * Worker thread: copies the bottom-left size pixels of window's display framebuffer into a free texture, which
+    * is (re)allocated with the size allocated, and makes it the newest completed frame.
+    */
+    void publish(vtkOpenGLRenderWindow* window, QSize const& allocated, QSize const& size);
+
+    /**
+    * Render thread: makes the newest completed frame the front texture, if one was published since the last call.
+    * Returns whether it did.
+    */
+    bool acquire();
+
+    // The front texture: its OpenGL name, allocated size and the size of the part holding the frame
+    unsigned texture() const { return m_textures[m_front].id; }
+    QSize textureSize() const { return m_textures[m_front].allocated; }
+    QSize frameSize() const { return m_textures[m_front].size; }
+
+    /**
+    * Render thread, after the scene graph rendered a frame.
+    */
+    void rendered();
+
+    /**
+    * Worker thread: deletes the textures.
+    */
+    void release();
+
+private:
+    struct Texture
+    {
+        unsigned id = 0;
+        QSize allocated;
+        QSize size;
+        void* written = nullptr;    // GLsync, the worker's copy
+        void* sampled = nullptr;    // GLsync, the scene graph's last use
+    };
+
+    QMutex m_mutex;                 // guards the indices and the fences
+    std::array<Texture, Textures> m_textures;
+    int m_front = 0;
+    int m_ready = -1;               // the newest completed frame, -1 if the front texture is the newest
+    unsigned m_fbo = 0;             // worker context only
+};
@@ -0,0 +1,220 @@
+#include "QQuickVtkShaderCache.h"
+#include "QQuickVtkTrace.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStandardPaths>
+
+#include <vtk_glew.h>
+#include <vtkObjectFactory.h>
+#include <vtkShader.h>
+#include <vtkShaderProgram.h>
+
+#include <atomic>
+#include <cstring>
+
+vtkStandardNewMacro(QQuickVtkShaderCache);
+vtkStandardNewMacro(QQuickVtkRenderWindow);
+
+namespace
+{
+    std::atomic<int> s_hits{ 0 };
+    std::atomic<int> s_misses{ 0 };
+    std::atomic<int> s_stale{ 0 };
+
+    struct Header
+    {
+        enum { Version = 1 };
+
+        char magic[4];      // "MVSH"
+        quint32 version;
+        quint32 format;     // the binary format returned by glGetProgramBinary
+        quint32 length;
+    };
+    const char s_magic[4] = { 'M', 'V', 'S', 'H' };
+
+    // vtkShaderProgram keeps its OpenGL handle and state protected, reach them through member pointers
+    struct ProgramAccess : vtkShaderProgram
+    {
+        static constexpr auto handle = &ProgramAccess::Handle;
+        static constexpr auto linked = &ProgramAccess::Linked;
+        static constexpr auto compiled = &ProgramAccess::Compiled;
+    };
+
+    // The directory of the current driver's binaries, or an empty string if the cache is disabled. Needs a
+    // current OpenGL context the first time.
+    QString directory()
+    {
+        static QMutex mutex;
+        static bool initialized = false;
+        static QString dir;
+
+        QMutexLocker lock(&mutex);
+        if (initialized)
+            return dir;
+        initialized = true;
+
+        if (qEnvironmentVariable("QQUICKVTK_SHADER_CACHE", "1") == "0")
+            return dir;
+
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if (formats <= 0)
+            return dir;
+
+        QCryptographicHash driver(QCryptographicHash::Sha1);
+        for (auto name : { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION })
+            if (auto* s = glGetString(name))
+                driver.addData(QByteArrayView(reinterpret_cast<const char*>(s)));
+
+        QDir root(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/shaders");
+        auto id = QString::fromLatin1(driver.result().toHex());
+
+        // The binaries of other drivers can't be loaded anymore
+        for (auto const& other : root.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+            if (other != id && QDir(root.filePath(other)).removeRecursively())
+                qInfo() << Q_FUNC_INFO << "Removed the shader binaries of another driver:" << other;
+
+        if (!root.mkpath(id)) {
+            qWarning() << Q_FUNC_INFO << "YIKES!! Can't create:'" << root.filePath(id) << "'";
+            return dir;
+        }
+        return dir = root.filePath(id);
+    }
+
+    QString fileName(QString const& dir, vtkShaderProgram* shader)
+    {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        for (auto* s : { shader->GetVertexShader(), shader->GetFragmentShader(), shader->GetGeometryShader() }) {
+            auto const& source = s->GetSource();
+            hash.addData(QByteArrayView(source.data(), qsizetype(source.size())));
+            hash.addData(QByteArrayView("\0", 1));
+        }
+        return dir + "/" + QString::fromLatin1(hash.result().toHex()) + ".bin";
+    }
+
+    bool load(vtkShaderProgram* shader, QString const& fileName)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+
+        QQuickVtkTrace::Scope trace("loadProgram");
+
+        Header header;
+        auto binary = file.readAll();
+        bool ok = binary.size() >= qsizetype(sizeof(header));
+        if (ok) {
+            std::memcpy(&header, binary.constData(), sizeof(header));
+            binary.remove(0, sizeof(header));
+            ok = std::memcmp(header.magic, s_magic, sizeof(s_magic)) == 0 && header.version == Header::Version
+                && header.length == quint32(binary.size());
+        }
+
+        GLuint program = 0;
+        if (ok) {
+            program = glCreateProgram();
+            glProgramBinary(program, header.format, binary.constData(), GLsizei(header.length));
+            GLint linked = GL_FALSE;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            ok = linked == GL_TRUE;
+        }
+
+        if (!ok) {
+            if (program)
+                glDeleteProgram(program);
+            file.remove();
+            ++s_stale;
+            return false;
+        }
+
+        shader->*ProgramAccess::handle = int(program);
+        shader->*ProgramAccess::linked = true;
+        shader->*ProgramAccess::compiled = true;
+        return true;
+    }
+
+    void store(vtkShaderProgram* shader, QString const& fileName)
+    {
+        auto program = GLuint(shader->GetHandle());
+
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+
+        Header header;
+        std::memcpy(header.magic, s_magic, sizeof(s_magic));
+        header.version = Header::Version;
+
+        QByteArray binary(length, Qt::Uninitialized);
+        GLenum format = 0;
+        GLsizei written = 0;
+        glGetProgramBinary(program, length, &written, &format, binary.data());
+        if (written <= 0)
+            return;
+        binary.resize(written);
+        header.format = format;
+        header.length = quint32(written);
+
+        QSaveFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly)
+            || file.write(reinterpret_cast<const char*>(&header), sizeof(header)) != qint64(sizeof(header))
+            || file.write(binary) != binary.size()
+            || !file.commit())
+            qWarning() << Q_FUNC_INFO << "YIKES!! Can't write:'" << fileName << "'" << file.errorString();
+    }
+}
+
+vtkShaderProgram* QQuickVtkShaderCache::ReadyShaderProgram(vtkShaderProgram* shader, vtkTransformFeedback* cap)
+{
+    // Programs with transform feedback bind their varyings before linking, leave them to VTK
+    if (!shader || shader->GetCompiled() || cap || shader->GetTransformFeedback())
+        return vtkOpenGLShaderCache::ReadyShaderProgram(shader, cap);
+
+    auto dir = directory();
+    if (dir.isEmpty())
+        return vtkOpenGLShaderCache::ReadyShaderProgram(shader, cap);
+
+    auto file = fileName(dir, shader);
+    if (load(shader, file)) {
+        ++s_hits;
+        QQuickVtkTrace::counter("shaderCacheHits", s_hits);
+        return vtkOpenGLShaderCache::ReadyShaderProgram(shader, cap);
+    }
+
+    ++s_misses;
+    QQuickVtkTrace::counter("shaderCacheMisses", s_misses);
+
+    auto* ready = vtkOpenGLShaderCache::ReadyShaderProgram(shader, cap);
+    if (ready && ready->GetCompiled())
+        store(ready, file);
+    return ready;
+}
+
+int QQuickVtkShaderCache::hits()
+{
+    return s_hits;
+}
+
+int QQuickVtkShaderCache::misses()
+{
+    return s_misses;
+}
+
+int QQuickVtkShaderCache::stale()
+{
+    return s_stale;
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+QQuickVtkRenderWindow::QQuickVtkRenderWindow()
+{
+    this->ShaderCache->UnRegister(this);
+    this->ShaderCache = QQuickVtkShaderCache::New();
+}
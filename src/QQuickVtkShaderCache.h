@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vtkGenericOpenGLRenderWindow.h>
+#include <vtkOpenGLShaderCache.h>
+
+/**
+* A vtkOpenGLShaderCache which keeps the binaries of the programs it links on disk (see glGetProgramBinary), so
+* the next launch loads them instead of compiling and linking the shaders again.
+*
+* Binaries are stored under QStandardPaths::CacheLocation, in a directory per OpenGL driver (vendor, renderer and
+* version) and named after a hash of the program's sources. Directories of other drivers are removed on first use.
+* A binary the driver rejects (e.g. after a driver update that kept its version string) is stale: it is removed
+* and the program is compiled as usual.
+*
+* Set the QQUICKVTK_SHADER_CACHE environment variable to 0 to disable the cache.
+*
+* \note Used by every QQuickVtkRenderWindow, i.e. by every QQuickVtkItem.
+*/
+class QQuickVtkShaderCache : public vtkOpenGLShaderCache
+{
+public:
+    static QQuickVtkShaderCache* New();
+    vtkTypeMacro(QQuickVtkShaderCache, vtkOpenGLShaderCache);
+
+    using vtkOpenGLShaderCache::ReadyShaderProgram;
+    vtkShaderProgram* ReadyShaderProgram(vtkShaderProgram* shader, vtkTransformFeedback* cap = nullptr) override;
+
+    // Counts of the process: programs loaded from disk, programs compiled (and stored), binaries found stale
+    static int hits();
+    static int misses();
+    static int stale();
+
+protected:
+    QQuickVtkShaderCache() = default;
+
+private:
+    QQuickVtkShaderCache(const QQuickVtkShaderCache&) = delete;
+    void operator=(const QQuickVtkShaderCache&) = delete;
+};
+
+/**
+* The VTK render window of a QQuickVtkItem: a vtkGenericOpenGLRenderWindow using a QQuickVtkShaderCache.
+*/
+class QQuickVtkRenderWindow : public vtkGenericOpenGLRenderWindow
+{
+public:
+    static QQuickVtkRenderWindow* New();
+    vtkTypeMacro(QQuickVtkRenderWindow, vtkGenericOpenGLRenderWindow);
+
+protected:
+    QQuickVtkRenderWindow();
+
+private:
+    QQuickVtkRenderWindow(const QQuickVtkRenderWindow&) = delete;
+    void operator=(const QQuickVtkRenderWindow&) = delete;
+};
@@ -0,0 +1,268 @@
+#include "QQuickVtkTrace.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    struct Event
+    {
+        const char* name;
+        const void* object;
+        qint64 ts;
+        qint64 dur;     // < 0 for counters
+        double value;
+    };
+
+    // Fixed size block of events. Only the owning thread writes, it publishes each event by a release-store of
+    // count. The block is handed over to the writer thread for good once next is set.
+    struct Chunk
+    {
+        enum { Capacity = 4096 };
+
+        Event events[Capacity];
+        std::atomic<int> count{ 0 };
+        std::atomic<Chunk*> next{ nullptr };
+    };
+
+    // The per-thread buffer, a single-producer single-consumer list of chunks
+    struct Buffer
+    {
+        Chunk* head = new Chunk;    // consumer side
+        int consumed = 0;
+        Chunk* tail = head;         // producer side
+
+        quint64 tid = 0;
+        QByteArray threadName;
+        std::atomic<bool> retired{ false };
+
+        void append(Event const& e)
+        {
+            int n = tail->count.load(std::memory_order_relaxed);
+            if (n == Chunk::Capacity) {
+                auto* c = new Chunk;
+                tail->next.store(c, std::memory_order_release);
+                tail = c;
+                n = 0;
+            }
+            tail->events[n] = e;
+            tail->count.store(n + 1, std::memory_order_release);
+        }
+    };
+
+    class Tracer;
+    Tracer& tracer();
+
+    class Tracer
+    {
+    public:
+        Tracer()
+        {
+            auto path = qEnvironmentVariable("QQUICKVTK_TRACE");
+            if (path.isEmpty())
+                return;
+
+            file.setFileName(path);
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                qWarning() << Q_FUNC_INFO << "YIKES!! Can't write the trace file:'" << path << "'";
+                return;
+            }
+
+            // The JSON array form of the format; a viewer copes with a missing closing bracket after a crash
+            file.write("[\n");
+            clock.start();
+            enabled = true;
+            writer = std::thread([this] { run(); });
+            std::atexit([] { tracer().finish(); });
+        }
+
+        // Drains what's been traced and closes the file. The tracer itself lives on: threads still running at exit
+        // may go on tracing, into buffers nobody drains anymore.
+        void finish()
+        {
+            {
+                QMutexLocker lock(&mutex);
+                quit = true;
+                wake.wakeAll();
+            }
+            writer.join();
+
+            file.write("\n]\n");
+            file.close();
+        }
+
+        Buffer* buffer()
+        {
+            // Registered once per thread, the writer thread deletes it once the thread is gone and it's drained
+            struct Local
+            {
+                Buffer* b = nullptr;
+                ~Local() { if (b) b->retired = true; }
+            };
+            thread_local Local local;
+
+            if (!local.b) {
+                local.b = new Buffer;
+                local.b->tid = quint64(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+                auto* t = QThread::currentThread();
+                local.b->threadName = t->objectName().toUtf8();
+                if (local.b->threadName.isEmpty())
+                    local.b->threadName = QCoreApplication::instance() && t == QCoreApplication::instance()->thread()
+                        ? "GUI thread" : QByteArray(t->metaObject()->className());
+
+                QMutexLocker lock(&mutex);
+                fresh.push_back(local.b);
+            }
+            return local.b;
+        }
+
+        bool enabled = false;
+        QElapsedTimer clock;
+
+    private:
+        void run()
+        {
+            QMutexLocker lock(&mutex);
+            for (bool done = false; !done;) {
+                if (!quit)
+                    wake.wait(&mutex, 500);
+                done = quit;
+                auto added = std::move(fresh);
+                fresh.clear();
+                lock.unlock();
+
+                for (auto* b : added) {
+                    buffers.push_back(b);
+                    write(QByteArray("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":") + QByteArray::number(b->tid)
+                        + ",\"args\":{\"name\":\"" + b->threadName + "\"}}");
+                }
+                drain();
+                file.flush();
+
+                lock.relock();
+            }
+        }
+
+        void drain()
+        {
+            for (auto it = buffers.begin(); it != buffers.end();) {
+                auto* b = *it;
+                bool retired = b->retired.load(std::memory_order_acquire);
+
+                for (;;) {
+                    int n = b->head->count.load(std::memory_order_acquire);
+                    for (; b->consumed < n; ++b->consumed)
+                        write(b->tid, b->head->events[b->consumed]);
+                    auto* next = b->head->next.load(std::memory_order_acquire);
+                    if (!next || b->consumed < Chunk::Capacity)
+                        break;
+                    delete b->head;
+                    b->head = next;
+                    b->consumed = 0;
+                }
+
+                if (retired) {
+                    delete b->head;
+                    delete b;
+                    it = buffers.erase(it);
+                } else
+                    ++it;
+            }
+        }
+
+        void write(quint64 tid, Event const& e)
+        {
+            QByteArray json;
+            json.reserve(160);
+            json += "{\"name\":\"";
+            json += e.name;
+            json += "\",\"pid\":1,\"tid\":";
+            json += QByteArray::number(tid);
+            json += ",\"ts\":";
+            json += QByteArray::number(e.ts / 1000.0, 'f', 3);
+            if (e.dur >= 0) {
+                json += ",\"ph\":\"X\",\"dur\":";
+                json += QByteArray::number(e.dur / 1000.0, 'f', 3);
+                if (e.object) {
+                    json += ",\"args\":{\"object\":\"0x";
+                    json += QByteArray::number(quint64(reinterpret_cast<quintptr>(e.object)), 16);
+                    json += "\"}";
+                }
+            } else {
+                // Counters of different objects are told apart by their id
+                json += ",\"ph\":\"C\",\"args\":{\"value\":";
+                json += QByteArray::number(e.value);
+                json += "}";
+                if (e.object) {
+                    json += ",\"id\":\"0x";
+                    json += QByteArray::number(quint64(reinterpret_cast<quintptr>(e.object)), 16);
+                    json += "\"";
+                }
+            }
+            json += "}";
+            write(json);
+        }
+
+        void write(QByteArray const& json)
+        {
+            if (!first)
+                file.write(",\n");
+            first = false;
+            file.write(json);
+        }
+
+        QFile file;
+        std::thread writer;
+        bool first = true;
+
+        QMutex mutex;
+        QWaitCondition wake;
+        bool quit = false;
+        std::vector<Buffer*> fresh;     // guarded by mutex
+
+        std::vector<Buffer*> buffers;   // writer thread only
+    };
+
+    // Leaked, there's no telling which threads trace until when at exit
+    Tracer& tracer()
+    {
+        static Tracer* t = new Tracer;
+        return *t;
+    }
+
+    bool const s_enabled = tracer().enabled;
+}
+
+bool QQuickVtkTrace::enabled()
+{
+    return s_enabled;
+}
+
+qint64 QQuickVtkTrace::now()
+{
+    return tracer().clock.nsecsElapsed();
+}
+
+void QQuickVtkTrace::complete(const char* name, qint64 begin, const void* object)
+{
+    if (!s_enabled)
+        return;
+    tracer().buffer()->append({ name, object, begin, now() - begin, 0 });
+}
+
+void QQuickVtkTrace::counter(const char* name, double value, const void* object)
+{
+    if (!s_enabled)
+        return;
+    tracer().buffer()->append({ name, object, now(), -1, value });
+}
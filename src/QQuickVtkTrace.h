@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QtCore/QtGlobal>
+
+/**
+* A low overhead tracer writing the Chrome trace event format (open the file in chrome://tracing or
+* https://ui.perfetto.dev).
+*
+* Tracing is enabled by setting the QQUICKVTK_TRACE environment variable to the path of the file to write.
+* Otherwise every call below is a single branch on a static flag.
+*
+* Each thread records into its own buffer without taking any lock; a background thread drains the buffers and
+* streams the events to the file about twice a second, and once more when the process exits.
+*
+* \note Names must be string literals (or otherwise outlive the process), only their address is recorded.
+*/
+namespace QQuickVtkTrace
+{
+    bool enabled();
+
+    // Nanoseconds since tracing started
+    qint64 now();
+
+    /**
+    * Records a complete event from begin to now() on the calling thread. object (e.g. the item) is written as an
+    * argument so events of different views can be told apart.
+    */
+    void complete(const char* name, qint64 begin, const void* object = nullptr);
+
+    /**
+    * Records a counter sample, e.g. a queue length.
+    */
+    void counter(const char* name, double value, const void* object = nullptr);
+
+    // Records a complete event for its lifetime
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name, const void* object = nullptr)
+            : m_name(name), m_object(object), m_begin(enabled() ? now() : -1)
+        {}
+
+        ~Scope()
+        {
+            if (m_begin >= 0)
+                complete(m_name, m_begin, m_object);
+        }
+
+    private:
+        Q_DISABLE_COPY(Scope)
+        const char* m_name;
+        const void* m_object;
+        qint64 m_begin;
+    };
+}
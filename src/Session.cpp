@@ -0,0 +1,422 @@
+#include "Session.h"
+#include "MappedMesh.h"
+#include "PointCloud.h"
+#include "QQuickVtkTrace.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+#include <QtCore/QSet>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTimer>
+
+#include <vtkPolyData.h>
+
+#include <algorithm>
+#include <cstring>
+
+static const char s_magic[8] = { 'M', 'V', 'S', 'E', 'S', 'S', 'N', 0 };
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+// What save() collected on the GUI thread, written out by write() on a worker thread
+struct Session::Capture
+{
+    struct Mesh
+    {
+        QString source;
+        GeometryCache::Handle handle;   // keeps the geometry alive while it's written
+        bool geometry = false;
+        bool decimated = false;
+    };
+
+    QList<SplitLayoutModel::Record> nodes;
+    int focused = -1;
+    QList<QPair<int, Pane>> panes;
+    QList<bool> reported;               // whether the camera of each pane was read
+    int waiting = 0;
+    QList<Mesh> meshes;
+};
+
+namespace
+{
+    // The mvmesh format holds polygons (or nothing but points), see writeMappedMesh()
+    bool embeddable(vtkPolyData* polyData)
+    {
+        return polyData && polyData->GetNumberOfPolys() > 0
+            && !polyData->GetNumberOfVerts() && !polyData->GetNumberOfLines() && !polyData->GetNumberOfStrips();
+    }
+
+    bool align(QIODevice& device)
+    {
+        static const char zeros[64] = {};
+        auto pad = (64 - device.pos() % 64) % 64;
+        return device.write(zeros, pad) == pad;
+    }
+
+    // Writes a 64 byte aligned section and sets offset to where it starts
+    bool writeSection(QIODevice& device, void const* data, qint64 bytes, quint64& offset)
+    {
+        if (!align(device))
+            return false;
+        offset = quint64(device.pos());
+        return device.write(static_cast<const char*>(data), bytes) == bytes;
+    }
+
+    template<class T>
+    bool writeSection(QIODevice& device, QList<T> const& records, quint64& offset)
+    {
+        return writeSection(device, records.constData(), qint64(records.size() * sizeof(T)), offset);
+    }
+
+    bool writeImage(QIODevice& device, vtkPolyData* polyData, quint64& offset, QString* error)
+    {
+        if (!align(device))
+            return false;
+        offset = quint64(device.pos());
+        return writeMappedMesh(polyData, device, error);
+    }
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+Session::Session(QObject* parent) : QObject(parent)
+{}
+
+Session::~Session() = default;
+
+SplitLayoutModel* Session::layout() const
+{
+    return m_layout;
+}
+
+void Session::setLayout(SplitLayoutModel* v)
+{
+    if (m_layout != v)
+        emit layoutChanged(m_layout = v);
+}
+
+void Session::attach(int pane, MyVtkItem* item)
+{
+    for (auto it = m_items.begin(); it != m_items.end();)
+        it = it.value() ? std::next(it) : m_items.erase(it);
+
+    m_items.insert(pane, item);
+    if (auto it = m_pending.find(pane); it != m_pending.end() && item) {
+        apply(item, *it);
+        m_pending.erase(it);
+    }
+}
+
+void Session::apply(MyVtkItem* item, Pane const& pane)
+{
+    item->setLinkGroup(pane.linkGroup);
+    item->setLinkTransform(pane.linkTransform);
+    item->setPointBudget(pane.pointBudget);
+
+    // The linked camera is set once the pane joined its group
+    if (pane.hasCamera)
+        item->restoreCamera(pane.camera);
+
+    // Forced, so the camera restored above is taken over even if the pane shows the source already
+    if (!pane.source.isEmpty())
+        item->setSource(pane.source, true);
+}
+
+void Session::save(QString const& fileName)
+{
+    if (!m_layout) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! There is no layout to save";
+        emit saved(fileName, false);
+        return;
+    }
+
+    auto capture = std::make_shared<Capture>();
+    capture->nodes = m_layout->records();
+    capture->focused = m_layout->focused();
+
+    QList<MyVtkItem*> items;
+    for (auto const& node : std::as_const(capture->nodes)) {
+        auto* item = node.pane >= 0 ? m_items.value(node.pane).data() : nullptr;
+        if (!item)
+            continue;
+
+        Pane pane;
+        pane.source = item->source();
+        pane.linkGroup = item->linkGroup();
+        pane.linkTransform = item->linkTransform();
+        pane.pointBudget = item->pointBudget();
+        capture->panes.append({ node.pane, pane });
+        items.append(item);
+    }
+    capture->reported.fill(false, items.size());
+    capture->waiting = int(items.size());
+
+    // The geometry computed for the panes' sources, point clouds are loaded from their files node by node anyway
+    QSet<QString> sources;
+    for (auto const& pane : std::as_const(capture->panes)) {
+        auto const& source = pane.second.source;
+        if (source.isEmpty() || sources.contains(source) || !pointCloudFile(source).isEmpty())
+            continue;
+        sources.insert(source);
+
+        auto handle = GeometryCache::instance().find({ source, {} });
+        if (!handle)
+            continue;
+
+        Capture::Mesh mesh;
+        mesh.source = source;
+        mesh.handle = handle;
+        mesh.geometry = mappedMeshFile(source).isEmpty() && embeddable(handle.polyData());
+        mesh.decimated = handle.isDecimated() && (!handle.decimated() || embeddable(handle.decimated()));
+        if (mesh.geometry || mesh.decimated)
+            capture->meshes.append(mesh);
+    }
+
+    // Written once every camera was read, or after CaptureTimeout without the ones which weren't
+    auto self = QPointer<Session>(this);
+    auto report = [self, capture, fileName](int index) {
+        if (capture->waiting < 0)
+            return;
+        if (index >= 0) {
+            if (std::exchange(capture->reported[index], true) || --capture->waiting > 0)
+                return;
+        }
+
+        capture->waiting = -1;
+        if (self)
+            self->write(fileName, capture);
+    };
+
+    for (int i = 0; i < items.size(); ++i)
+        items[i]->captureCamera([capture, report, i](MyVtkItem::CameraState const& camera) {
+            // Too late, the file is being written
+            if (capture->waiting < 0)
+                return;
+            capture->panes[i].second.camera = camera;
+            capture->panes[i].second.hasCamera = true;
+            report(i);
+        });
+
+    if (items.isEmpty())
+        report(-1);
+    else
+        QTimer::singleShot(CaptureTimeout, this, [report] { report(-1); });
+}
+
+void Session::write(QString const& fileName, std::shared_ptr<Capture> const& capture)
+{
+    QThreadPool::globalInstance()->start([fileName, capture, self = QPointer<Session>(this)] {
+        QQuickVtkTrace::Scope trace("saveSession");
+
+        QByteArray strings;
+        auto string = [&strings](QString const& s) {
+            auto utf8 = s.toUtf8();
+            SessionString result = { quint32(strings.size()), quint32(utf8.size()) };
+            strings += utf8;
+            return result;
+        };
+
+        QList<SessionNode> nodes;
+        for (auto const& record : std::as_const(capture->nodes))
+            nodes.append({ record.pane, quint32(record.orientation), quint32(record.children), 0, record.share });
+
+        QList<SessionPane> panes;
+        for (auto const& [id, pane] : std::as_const(capture->panes)) {
+            SessionPane p = {};
+            p.pane = id;
+            p.pointBudget = pane.pointBudget;
+            p.source = string(pane.source);
+            p.linkGroup = string(pane.linkGroup);
+            pane.linkTransform.copyDataTo(p.linkTransform);
+            if (pane.hasCamera) {
+                p.flags |= SessionPane::Camera;
+                std::copy_n(pane.camera.position, 3, p.position);
+                std::copy_n(pane.camera.focalPoint, 3, p.focalPoint);
+                std::copy_n(pane.camera.viewUp, 3, p.viewUp);
+                p.viewAngle = pane.camera.viewAngle;
+                p.parallelScale = pane.camera.parallelScale;
+                if (pane.camera.parallelProjection)
+                    p.flags |= SessionPane::ParallelProjection;
+            }
+            panes.append(p);
+        }
+
+        QSaveFile file(fileName);
+        QString error;
+        bool ok = file.open(QIODevice::WriteOnly);
+
+        // The header goes first, it's written again once the offsets are known
+        SessionHeader header = {};
+        std::memcpy(header.magic, s_magic, sizeof(s_magic));
+        header.version = SessionHeader::Version;
+        header.focused = capture->focused;
+        ok = ok && file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == qint64(sizeof(header));
+
+        QList<SessionMesh> meshes;
+        for (auto const& mesh : std::as_const(capture->meshes)) {
+            if (!ok)
+                break;
+
+            SessionMesh m = {};
+            m.source = string(mesh.source);
+            if (mesh.geometry) {
+                m.flags |= SessionMesh::Geometry;
+                ok = writeImage(file, mesh.handle.polyData(), m.geometry, &error);
+            }
+            if (mesh.decimated) {
+                m.flags |= SessionMesh::Decimated;
+                if (auto* lod = mesh.handle.decimated())
+                    ok = ok && writeImage(file, lod, m.lod, &error);
+            }
+            meshes.append(m);
+        }
+
+        header.numberOfNodes = quint32(nodes.size());
+        header.numberOfPanes = quint32(panes.size());
+        header.numberOfMeshes = quint32(meshes.size());
+        header.stringsSize = quint32(strings.size());
+        ok = ok && writeSection(file, nodes, header.nodes)
+            && writeSection(file, panes, header.panes)
+            && writeSection(file, meshes, header.meshes)
+            && writeSection(file, strings.constData(), strings.size(), header.strings)
+            && file.seek(0) && file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == qint64(sizeof(header))
+            && file.commit();
+
+        if (!ok)
+            qWarning() << Q_FUNC_INFO << "YIKES!! Can't write" << fileName << ":" << (error.isEmpty() ? file.errorString() : error);
+
+        QMetaObject::invokeMethod(qApp, [self, fileName, ok] {
+            if (self)
+                emit self->saved(fileName, ok);
+            }, Qt::QueuedConnection);
+        });
+}
+
+bool Session::restore(QString const& fileName)
+{
+    QQuickVtkTrace::Scope trace("restoreSession");
+
+    if (!m_layout) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! There is no layout to restore";
+        return false;
+    }
+
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+    qWarning() << Q_FUNC_INFO << "YIKES!! Session snapshots are little-endian, can't read" << fileName;
+    return false;
+#endif
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! Can't open" << fileName << ":" << file.errorString();
+        return false;
+    }
+
+    const auto size = quint64(file.size());
+    const uchar* data = size >= sizeof(SessionHeader) ? file.map(0, qint64(size)) : nullptr;
+    SessionHeader header = {};
+    if (data)
+        std::memcpy(&header, data, sizeof(header));
+
+    auto fits = [size](quint64 offset, quint64 count, quint64 bytes) {
+        return offset % 8 == 0 && offset <= size && count <= (size - offset) / bytes;
+    };
+    if (!data || std::memcmp(header.magic, s_magic, sizeof(s_magic)) != 0 || header.version != SessionHeader::Version
+        || !fits(header.nodes, header.numberOfNodes, sizeof(SessionNode))
+        || !fits(header.panes, header.numberOfPanes, sizeof(SessionPane))
+        || !fits(header.meshes, header.numberOfMeshes, sizeof(SessionMesh))
+        || !fits(header.strings, header.stringsSize, 1)) {
+        qWarning() << Q_FUNC_INFO << "YIKES!!" << fileName << "is not a version" << SessionHeader::Version << "session snapshot";
+        return false;
+    }
+
+    auto string = [&](SessionString const& s) {
+        if (s.offset > header.stringsSize || s.size > header.stringsSize - s.offset)
+            return QString();
+        return QString::fromUtf8(reinterpret_cast<const char*>(data + header.strings + s.offset), qsizetype(s.size));
+    };
+    auto const* savedNodes = reinterpret_cast<SessionNode const*>(data + header.nodes);
+    auto const* savedPanes = reinterpret_cast<SessionPane const*>(data + header.panes);
+    auto const* savedMeshes = reinterpret_cast<SessionMesh const*>(data + header.meshes);
+
+    QList<SplitLayoutModel::Record> nodes;
+    for (quint32 i = 0; i < header.numberOfNodes; ++i) {
+        auto const& n = savedNodes[i];
+        nodes.append({ n.pane, n.orientation == Qt::Vertical ? Qt::Vertical : Qt::Horizontal, int(n.children), n.share });
+    }
+
+    QHash<int, Pane> panes;
+    for (quint32 i = 0; i < header.numberOfPanes; ++i) {
+        auto const& p = savedPanes[i];
+        Pane pane;
+        pane.source = string(p.source);
+        pane.linkGroup = string(p.linkGroup);
+        pane.linkTransform = QMatrix4x4(p.linkTransform);
+        pane.pointBudget = p.pointBudget;
+        pane.hasCamera = p.flags & SessionPane::Camera;
+        std::copy_n(p.position, 3, pane.camera.position);
+        std::copy_n(p.focalPoint, 3, pane.camera.focalPoint);
+        std::copy_n(p.viewUp, 3, pane.camera.viewUp);
+        pane.camera.viewAngle = p.viewAngle;
+        pane.camera.parallelScale = p.parallelScale;
+        pane.camera.parallelProjection = p.flags & SessionPane::ParallelProjection;
+        panes.insert(p.pane, pane);
+    }
+
+    // The geometry goes into the cache before the panes ask for it, mapped straight from the file (and validated
+    // like any .mvmesh file, see readMappedMeshes()). Only the images saved are read, so error is about one of them.
+    QVector<quint64> offsets;
+    QVector<int> geometryAt(qsizetype(header.numberOfMeshes), -1), lodAt(qsizetype(header.numberOfMeshes), -1);
+    for (quint32 i = 0; i < header.numberOfMeshes; ++i) {
+        auto const& m = savedMeshes[i];
+        if (m.flags & SessionMesh::Geometry) {
+            geometryAt[i] = int(offsets.size());
+            offsets << m.geometry;
+        }
+        if ((m.flags & SessionMesh::Decimated) && m.lod) {
+            lodAt[i] = int(offsets.size());
+            offsets << m.lod;
+        }
+    }
+    QString error;
+    auto meshes = readMappedMeshes(fileName, offsets, &error);
+
+    QList<GeometryCache::Handle> geometry;
+    for (quint32 i = 0; i < header.numberOfMeshes; ++i) {
+        auto const& m = savedMeshes[i];
+        auto polyData = meshes.value(geometryAt[i]), lod = meshes.value(lodAt[i]);
+
+        // A mesh which didn't make it is computed again, as if it hadn't been saved
+        bool geometryValid = !(m.flags & SessionMesh::Geometry) || polyData;
+        bool lodValid = !(m.flags & SessionMesh::Decimated) || !m.lod || lod;
+        if (!geometryValid || !lodValid) {
+            qWarning() << Q_FUNC_INFO << "YIKES!!" << error;
+            continue;
+        }
+
+        geometry << GeometryCache::instance().insert({ string(m.source), {} }, polyData, m.flags & SessionMesh::Decimated, lod);
+    }
+
+    auto ids = m_layout->restore(nodes, header.focused);
+    if (ids.isEmpty())
+        return false;
+
+    // Items created by the layout while it was restored are attached already, the others pick their state up
+    // in attach()
+    m_geometry = geometry;
+    m_pending.clear();
+    for (auto it = panes.cbegin(); it != panes.cend(); ++it) {
+        if (!ids.contains(it.key()))
+            continue;
+
+        int pane = ids.value(it.key());
+        if (auto item = m_items.value(pane))
+            apply(item, it.value());
+        else
+            m_pending.insert(pane, it.value());
+    }
+
+    return true;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "GeometryCache.h"
+#include "MyVtkItem.h"
+#include "SplitLayoutModel.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtCore/QString>
+#include <QtGui/QMatrix4x4>
+
+#include <memory>
+
+/**
+* The .mvsession file format: a snapshot of the panes of a window, laid out so it can be memory-mapped and its
+* geometry handed to VTK without parsing or copying (see MappedMeshHeader).
+*
+*   SessionHeader (64 bytes)
+*   geometry:     .mvmesh images (MappedMeshHeader and its sections)
+*   nodes:        numberOfNodes SessionNode, the layout tree in pre-order (see SplitLayoutModel::records())
+*   panes:        numberOfPanes SessionPane
+*   meshes:       numberOfMeshes SessionMesh, pointing at the geometry
+*   strings:      stringsSize bytes of UTF-8, see SessionString
+*
+* Sections start at the byte offsets given in the header (64 byte aligned), all values are little-endian.
+*/
+struct SessionHeader
+{
+    enum { Version = 1 };
+
+    char magic[8];              // "MVSESSN\0"
+    quint32 version;
+    qint32 focused;             // the saved id of the focused pane
+    quint32 numberOfNodes;
+    quint32 numberOfPanes;
+    quint32 numberOfMeshes;
+    quint32 stringsSize;
+    quint64 nodes;              // section offsets in bytes from the start of the file
+    quint64 panes;
+    quint64 meshes;
+    quint64 strings;
+};
+static_assert(sizeof(SessionHeader) == 64, "SessionHeader must be 64 bytes");
+
+// A string of the strings section
+struct SessionString
+{
+    quint32 offset;
+    quint32 size;
+};
+
+struct SessionNode
+{
+    qint32 pane;                // the saved id of the pane, -1 for containers
+    quint32 orientation;        // Qt::Orientation
+    quint32 children;
+    quint32 reserved;
+    double share;
+};
+static_assert(sizeof(SessionNode) == 24, "SessionNode must be 24 bytes");
+
+struct SessionPane
+{
+    enum Flags : quint32 { Camera = 1, ParallelProjection = 2 };
+
+    qint32 pane;                // the saved id of the pane
+    qint32 pointBudget;
+    SessionString source;
+    SessionString linkGroup;
+    float linkTransform[16];    // row-major
+    double position[3];         // the camera, if flags has Camera
+    double focalPoint[3];
+    double viewUp[3];
+    double viewAngle;
+    double parallelScale;
+    quint32 flags;
+    quint32 reserved;
+};
+static_assert(sizeof(SessionPane) == 184, "SessionPane must be 184 bytes");
+
+struct SessionMesh
+{
+    enum Flags : quint32 { Geometry = 1, Decimated = 2 };
+
+    SessionString source;
+    quint32 flags;
+    quint32 reserved;
+    quint64 geometry;           // the image of the source's output if flags has Geometry, otherwise 0
+    quint64 lod;                // the image of its decimated() copy if flags has Decimated, 0 if it has none
+};
+static_assert(sizeof(SessionMesh) == 32, "SessionMesh must be 32 bytes");
+
+/**
+* Saves and restores the panes of a SplitLayoutModel: the layout tree and, of the MyVtkItem of each pane, its
+* source, camera, linkGroup, linkTransform and pointBudget, together with the geometry computed for the sources.
+*
+* Restoring maps the file and puts its geometry into the GeometryCache zero-copy, so the panes find their sources
+* computed (and decimated) already, instead of executing them again. Sources backed by files of their own (see
+* registerMappedMeshes() and registerPointClouds()) are mapped from those files, only the level of detail computed
+* for them goes into the snapshot.
+*
+* Panes hand their item over with attach() once created, e.g. from Component.onCompleted of the paneDelegate.
+*/
+class Session : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(SplitLayoutModel* layout READ layout WRITE setLayout NOTIFY layoutChanged)
+
+public:
+    // How long save() waits for the cameras, panes which don't render (e.g. hidden ones) are saved without one
+    enum { CaptureTimeout = 1000 };
+
+    explicit Session(QObject* parent = nullptr);
+    ~Session() override;
+
+    SplitLayoutModel* layout() const;
+    void setLayout(SplitLayoutModel* v);
+
+    // The item showing pane. A pane restore() created gets its state once its item is attached.
+    Q_INVOKABLE void attach(int pane, MyVtkItem* item);
+
+    /**
+    * Writes the session to fileName, see saved(). The cameras are read at the next sync of each pane, the file is
+    * then written on a worker thread.
+    */
+    Q_INVOKABLE void save(QString const& fileName);
+
+    /**
+    * Replaces the layout by the one saved in fileName and restores its panes. Returns false and keeps the layout
+    * if fileName isn't a session snapshot.
+    *
+    * \note The geometry restored stays in the GeometryCache until the next restore(), whether panes show it or not.
+    */
+    Q_INVOKABLE bool restore(QString const& fileName);
+
+Q_SIGNALS:
+    void layoutChanged(SplitLayoutModel*);
+    void saved(QString fileName, bool ok);
+
+private:
+    struct Pane
+    {
+        QString source;
+        QString linkGroup;
+        QMatrix4x4 linkTransform;
+        int pointBudget = 0;
+        bool hasCamera = false;
+        MyVtkItem::CameraState camera;
+    };
+    struct Capture;
+
+    static void apply(MyVtkItem* item, Pane const& pane);
+    void write(QString const& fileName, std::shared_ptr<Capture> const& capture);
+
+    QPointer<SplitLayoutModel> m_layout;
+    QHash<int, QPointer<MyVtkItem>> m_items;
+    QHash<int, Pane> m_pending;                 // restored panes waiting for their item
+    QList<GeometryCache::Handle> m_geometry;    // put into the GeometryCache by restore()
+};
@@ -0,0 +1,546 @@
+#include "SplitLayoutModel.h"
+
+#include <QtCore/QDebug>
+#include <QtCore/QSet>
+
+#include <cmath>
+#include <functional>
+#include <utility>
+#include <vector>
+
+struct SplitLayoutModel::Node
+{
+    Node* parent = nullptr;
+    int row = 0;                    // in parent->children
+    int pane = -1;                  // the pane's id, -1 for containers
+    Qt::Orientation orientation = Qt::Horizontal;   // containers: how the children are laid out
+    qreal share = 1;                // of the parent, the shares of a container's children sum up to 1
+    QRectF rect;                    // in the layout, normalized to [0, 1]
+    std::vector<std::unique_ptr<Node>> children;
+    int paneRow = -1;               // panes: the row in m_panes
+    std::vector<int> handles;       // containers: the rows in m_handles of the handles between the children
+};
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+SplitLayoutPanes::SplitLayoutPanes(SplitLayoutModel* layout) : QAbstractListModel(layout), m_layout(layout)
+{}
+
+int SplitLayoutPanes::rowCount(QModelIndex const& parent) const
+{
+    return parent.isValid() ? 0 : int(m_layout->m_panes.size());
+}
+
+QVariant SplitLayoutPanes::data(QModelIndex const& index, int role) const
+{
+    if (!checkIndex(index, CheckIndexOption::IndexIsValid))
+        return {};
+
+    auto* node = m_layout->m_panes[index.row()];
+    switch (role)
+    {
+    case PaneIdRole: return node->pane;
+    case RectRole: return node->rect;
+    default: return {};
+    }
+}
+
+QHash<int, QByteArray> SplitLayoutPanes::roleNames() const
+{
+    return { { PaneIdRole, "paneId" }, { RectRole, "rect" } };
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+SplitLayoutHandles::SplitLayoutHandles(SplitLayoutModel* layout) : QAbstractListModel(layout), m_layout(layout)
+{}
+
+int SplitLayoutHandles::rowCount(QModelIndex const& parent) const
+{
+    return parent.isValid() ? 0 : int(m_layout->m_handles.size());
+}
+
+QVariant SplitLayoutHandles::data(QModelIndex const& index, int role) const
+{
+    if (!checkIndex(index, CheckIndexOption::IndexIsValid))
+        return {};
+
+    auto const& handle = m_layout->m_handles[index.row()];
+    switch (role)
+    {
+    case RectRole: return handle.rect;
+    case OrientationRole: return int(handle.container->orientation);
+    default: return {};
+    }
+}
+
+QHash<int, QByteArray> SplitLayoutHandles::roleNames() const
+{
+    return { { RectRole, "rect" }, { OrientationRole, "orientation" } };
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+SplitLayoutModel::SplitLayoutModel(QObject* parent) : QAbstractItemModel(parent),
+    m_root(std::make_unique<Node>()),
+    m_paneModel(new SplitLayoutPanes(this)),
+    m_handleModel(new SplitLayoutHandles(this))
+{
+    m_root->rect = { 0, 0, 1, 1 };
+
+    // The first pane
+    auto pane = createPane();
+    auto* node = pane.get();
+    m_root->children.push_back(std::move(pane));
+    node->parent = m_root.get();
+    node->rect = m_root->rect;
+    node->paneRow = 0;
+    m_panes.append(node);
+    setFocused(node->pane);
+}
+
+SplitLayoutModel::~SplitLayoutModel() = default;
+
+int SplitLayoutModel::split(int pane, Qt::Orientation orientation)
+{
+    auto* node = m_nodes.value(pane);
+    if (!node) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! There is no pane" << pane;
+        return -1;
+    }
+
+    auto* container = node->parent;
+    if (container->children.size() == 1)
+        container->orientation = orientation;
+
+    auto created = createPane();
+    auto* added = created.get();
+
+    if (container->orientation == orientation) {
+        // Next to pane, which gives half of its share
+        node->share /= 2;
+        added->share = node->share;
+        insert(container, node->row + 1, std::move(created));
+        addHandle(container);
+        layout(container, container->rect);
+    } else {
+        // Replace pane by a container holding both
+        auto inner = std::make_unique<Node>();
+        auto* split = inner.get();
+        split->orientation = orientation;
+        split->share = node->share;
+        int row = node->row;
+        auto taken = take(node);
+        taken->share = added->share = 0.5;
+        taken->parent = split;
+        taken->row = 0;
+        split->children.push_back(std::move(taken));
+        added->parent = split;
+        added->row = 1;
+        split->children.push_back(std::move(created));
+        insert(container, row, std::move(inner));
+        addHandle(split);
+        layout(split, node->rect);
+    }
+
+    // Laid out before it's added, so the delegate starts out in place
+    added->paneRow = int(m_panes.size());
+    m_paneModel->beginInsertRows({}, added->paneRow, added->paneRow);
+    m_panes.append(added);
+    m_paneModel->endInsertRows();
+    emit countChanged(count());
+
+    setFocused(added->pane);
+    return added->pane;
+}
+
+bool SplitLayoutModel::unsplit(int pane)
+{
+    auto* node = m_nodes.value(pane);
+    if (!node) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! There is no pane" << pane;
+        return false;
+    }
+
+    auto* container = node->parent;
+    if (container == m_root.get() && container->children.size() == 1) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! Can't unsplit the last pane";
+        return false;
+    }
+
+    // The neighbour before it (or after it if it's the first) takes its share
+    int row = node->row;
+    auto& neighbour = container->children[row > 0 ? row - 1 : row + 1];
+    neighbour->share += node->share;
+
+    // The panes after it move up a row (and keep their delegates)
+    int paneRow = node->paneRow;
+    m_paneModel->beginRemoveRows({}, paneRow, paneRow);
+    m_panes.removeAt(paneRow);
+    for (int i = paneRow; i < m_panes.size(); ++i)
+        m_panes[i]->paneRow = i;
+    m_paneModel->endRemoveRows();
+
+    m_nodes.remove(pane);
+    forget(pane);
+    take(node);
+    removeHandle(container);
+
+    // A container with a single child is replaced by it, only the root may hold a single pane
+    if (container != m_root.get() && container->children.size() == 1) {
+        auto* parent = container->parent;
+        int at = container->row;
+        auto child = take(container->children.front().get());
+        child->share = container->share;
+        take(container);
+        container = parent;
+        insert(parent, at, std::move(child));
+    }
+    layout(container, container->rect);
+
+    emit countChanged(count());
+    return true;
+}
+
+void SplitLayoutModel::moveHandle(int handle, qreal position)
+{
+    if (handle < 0 || handle >= m_handles.size())
+        return;
+
+    auto* container = m_handles[handle].container;
+    auto* a = container->children[m_handles[handle].index].get();
+    auto* b = container->children[m_handles[handle].index + 1].get();
+
+    bool horizontal = container->orientation == Qt::Horizontal;
+    auto extent = horizontal ? container->rect.width() : container->rect.height();
+    auto begin = horizontal ? a->rect.left() : a->rect.top();
+    auto end = horizontal ? b->rect.right() : b->rect.bottom();
+    auto margin = MinShare * extent;
+    if (end - begin <= 2 * margin)
+        return;
+
+    position = qBound(begin + margin, position, end - margin);
+    auto share = a->share + b->share;
+    a->share = share * (position - begin) / (end - begin);
+    b->share = share - a->share;
+
+    layout(container, container->rect);
+}
+
+QList<SplitLayoutModel::Record> SplitLayoutModel::records() const
+{
+    QList<Record> records;
+
+    std::vector<Node const*> stack = { m_root.get() };
+    while (!stack.empty()) {
+        auto const* node = stack.back();
+        stack.pop_back();
+        records.append({ node->pane, node->orientation, int(node->children.size()), node->share });
+        for (auto it = node->children.rbegin(); it != node->children.rend(); ++it)
+            stack.push_back(it->get());
+    }
+    return records;
+}
+
+QHash<int, int> SplitLayoutModel::restore(QList<Record> const& records, int focused)
+{
+    // Deeper than any layout split by hand, but shallow enough for the recursion below whatever records holds
+    const int maxDepth = 256;
+
+    // Build the tree aside, the current one stays if records turn out to be invalid
+    int next = 0;
+    QSet<int> saved;
+    std::function<std::unique_ptr<Node>(Node*, int)> build = [&](Node* parent, int depth) -> std::unique_ptr<Node> {
+        if (next >= records.size() || depth > maxDepth)
+            return nullptr;
+
+        auto const& record = records[next++];
+        auto node = std::make_unique<Node>();
+        node->parent = parent;
+        node->pane = record.pane;
+        node->orientation = record.orientation == Qt::Vertical ? Qt::Vertical : Qt::Horizontal;
+        node->share = record.share;
+        if (!(record.share > 0) || !std::isfinite(record.share) || (!parent && record.pane >= 0))
+            return nullptr;
+
+        if (record.pane >= 0) {
+            if (record.children != 0 || saved.contains(record.pane))
+                return nullptr;
+            saved.insert(record.pane);
+            return node;
+        }
+
+        // Only the root may hold a single child
+        if (record.children < (parent ? 2 : 1))
+            return nullptr;
+
+        qreal shares = 0;
+        for (int i = 0; i < record.children; ++i) {
+            auto child = build(node.get(), depth + 1);
+            if (!child)
+                return nullptr;
+            child->row = i;
+            shares += child->share;
+            node->children.push_back(std::move(child));
+        }
+        for (auto const& child : node->children)
+            child->share /= shares;
+        return node;
+    };
+
+    auto root = build(nullptr, 0);
+    if (!root || next != records.size()) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! Not a valid layout tree";
+        return {};
+    }
+
+    beginResetModel();
+    m_paneModel->beginResetModel();
+    m_handleModel->beginResetModel();
+
+    m_root = std::move(root);
+    m_nodes.clear();
+    m_panes.clear();
+    m_handles.clear();
+    m_history.clear();
+    m_historyIndex.clear();
+
+    // New ids, in pre-order like the saved ones
+    QHash<int, int> ids;
+    std::function<void(Node*)> add = [&](Node* node) {
+        if (node->pane >= 0) {
+            ids.insert(node->pane, node->pane = m_nextId++);
+            m_nodes.insert(node->pane, node);
+            node->paneRow = int(m_panes.size());
+            m_panes.append(node);
+        }
+        for (int i = 0; i + 1 < int(node->children.size()); ++i) {
+            node->handles.push_back(int(m_handles.size()));
+            m_handles.append({ node, i, {} });
+        }
+        for (auto const& child : node->children)
+            add(child.get());
+    };
+    add(m_root.get());
+
+    layout(m_root.get(), { 0, 0, 1, 1 }, false);
+
+    m_handleModel->endResetModel();
+    m_paneModel->endResetModel();
+    endResetModel();
+    emit countChanged(count());
+
+    setFocused(ids.value(focused, m_panes.front()->pane));
+    return ids;
+}
+
+int SplitLayoutModel::focused() const
+{
+    return m_focused;
+}
+
+void SplitLayoutModel::setFocused(int pane)
+{
+    if (!m_nodes.contains(pane))
+        return;
+
+    // Move it to the end of the history
+    if (auto it = m_historyIndex.find(pane); it != m_historyIndex.end())
+        m_history.splice(m_history.end(), m_history, *it);
+    else
+        m_historyIndex.insert(pane, m_history.insert(m_history.end(), pane));
+
+    if (m_focused != pane)
+        emit focusedChanged(m_focused = pane);
+}
+
+int SplitLayoutModel::count() const
+{
+    return int(m_panes.size());
+}
+
+QAbstractItemModel* SplitLayoutModel::panes() const
+{
+    return m_paneModel;
+}
+
+QAbstractItemModel* SplitLayoutModel::handles() const
+{
+    return m_handleModel;
+}
+
+QModelIndex SplitLayoutModel::index(int row, int column, QModelIndex const& parent) const
+{
+    auto* node = parent.isValid() ? static_cast<Node*>(parent.internalPointer()) : m_root.get();
+    if (column != 0 || row < 0 || row >= int(node->children.size()))
+        return {};
+    return createIndex(row, 0, node->children[row].get());
+}
+
+QModelIndex SplitLayoutModel::parent(QModelIndex const& index) const
+{
+    if (!index.isValid())
+        return {};
+    return indexOf(static_cast<Node*>(index.internalPointer())->parent);
+}
+
+int SplitLayoutModel::rowCount(QModelIndex const& parent) const
+{
+    auto* node = parent.isValid() ? static_cast<Node*>(parent.internalPointer()) : m_root.get();
+    return int(node->children.size());
+}
+
+int SplitLayoutModel::columnCount(QModelIndex const&) const
+{
+    return 1;
+}
+
+QVariant SplitLayoutModel::data(QModelIndex const& index, int role) const
+{
+    if (!checkIndex(index, CheckIndexOption::IndexIsValid))
+        return {};
+
+    auto* node = static_cast<Node*>(index.internalPointer());
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return node->pane >= 0 ? QString("pane %1").arg(node->pane)
+            : node->orientation == Qt::Horizontal ? QString("horizontal") : QString("vertical");
+    case PaneIdRole: return node->pane;
+    case OrientationRole: return int(node->orientation);
+    case RectRole: return node->rect;
+    default: return {};
+    }
+}
+
+QHash<int, QByteArray> SplitLayoutModel::roleNames() const
+{
+    auto names = QAbstractItemModel::roleNames();
+    names.insert(PaneIdRole, "paneId");
+    names.insert(OrientationRole, "orientation");
+    names.insert(RectRole, "rect");
+    return names;
+}
+
+QModelIndex SplitLayoutModel::indexOf(Node* node) const
+{
+    return !node || node == m_root.get() ? QModelIndex() : createIndex(node->row, 0, node);
+}
+
+void SplitLayoutModel::insert(Node* parent, int row, std::unique_ptr<Node> node)
+{
+    beginInsertRows(indexOf(parent), row, row);
+    node->parent = parent;
+    parent->children.insert(parent->children.begin() + row, std::move(node));
+    for (int i = row; i < int(parent->children.size()); ++i)
+        parent->children[i]->row = i;
+    endInsertRows();
+}
+
+std::unique_ptr<SplitLayoutModel::Node> SplitLayoutModel::take(Node* node)
+{
+    auto* parent = node->parent;
+    int row = node->row;
+
+    beginRemoveRows(indexOf(parent), row, row);
+    auto taken = std::move(parent->children[row]);
+    parent->children.erase(parent->children.begin() + row);
+    for (int i = row; i < int(parent->children.size()); ++i)
+        parent->children[i]->row = i;
+    endRemoveRows();
+
+    taken->parent = nullptr;
+    return taken;
+}
+
+std::unique_ptr<SplitLayoutModel::Node> SplitLayoutModel::createPane()
+{
+    auto node = std::make_unique<Node>();
+    node->pane = m_nextId++;
+    m_nodes.insert(node->pane, node.get());
+    return node;
+}
+
+// A container got a child, it got a handle more
+void SplitLayoutModel::addHandle(Node* container)
+{
+    int row = int(m_handles.size());
+    m_handleModel->beginInsertRows({}, row, row);
+    container->handles.push_back(row);
+    m_handles.append({ container, int(container->children.size()) - 2, {} });
+    m_handleModel->endInsertRows();
+}
+
+// A container lost a child, it lost its last handle. The last row takes the place of the removed one, so no other
+// row moves: handles have no order, unlike panes.
+void SplitLayoutModel::removeHandle(Node* container)
+{
+    if (container->handles.empty())
+        return;
+
+    int row = container->handles.back(), last = int(m_handles.size()) - 1;
+    container->handles.pop_back();
+    if (row != last) {
+        m_handles[row] = m_handles[last];
+        m_handles[row].container->handles[m_handles[row].index] = row;
+        emit m_handleModel->dataChanged(m_handleModel->index(row), m_handleModel->index(row));
+    }
+
+    m_handleModel->beginRemoveRows({}, last, last);
+    m_handles.removeLast();
+    m_handleModel->endRemoveRows();
+}
+
+void SplitLayoutModel::layout(Node* node, QRectF const& rect, bool notify)
+{
+    if (node->rect != rect) {
+        node->rect = rect;
+        if (auto index = indexOf(node); notify && index.isValid())
+            emit dataChanged(index, index, { RectRole });
+        if (notify && node->paneRow >= 0)
+            emit m_paneModel->dataChanged(m_paneModel->index(node->paneRow), m_paneModel->index(node->paneRow), { SplitLayoutPanes::RectRole });
+    }
+
+    // The last child takes what's left, so rounding never leaves a gap
+    bool horizontal = node->orientation == Qt::Horizontal;
+    auto offset = horizontal ? rect.left() : rect.top();
+    auto end = horizontal ? rect.right() : rect.bottom();
+    for (auto const& child : node->children) {
+        auto size = &child == &node->children.back() ? end - offset : (horizontal ? rect.width() : rect.height()) * child->share;
+        layout(child.get(), horizontal
+            ? QRectF(offset, rect.top(), size, rect.height())
+            : QRectF(rect.left(), offset, rect.width(), size), notify);
+        offset += size;
+    }
+
+    // The handles sit between the children just laid out
+    for (int handle : node->handles)
+        layoutHandle(handle, notify);
+}
+
+void SplitLayoutModel::layoutHandle(int row, bool notify)
+{
+    auto& handle = m_handles[row];
+    auto const& container = handle.container->rect;
+    auto const& before = handle.container->children[handle.index]->rect;
+    auto rect = handle.container->orientation == Qt::Horizontal
+        ? QRectF(before.right(), container.top(), 0, container.height())
+        : QRectF(container.left(), before.bottom(), container.width(), 0);
+    if (handle.rect != rect) {
+        handle.rect = rect;
+        if (notify)
+            emit m_handleModel->dataChanged(m_handleModel->index(row), m_handleModel->index(row), { SplitLayoutHandles::RectRole });
+    }
+}
+
+// Drops an unsplit pane from the focus history, the pane focused before it takes the focus
+void SplitLayoutModel::forget(int pane)
+{
+    if (auto it = m_historyIndex.find(pane); it != m_historyIndex.end()) {
+        m_history.erase(*it);
+        m_historyIndex.erase(it);
+    }
+
+    if (m_focused == pane)
+        emit focusedChanged(m_focused = m_history.empty() ? -1 : m_history.back());
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <QtCore/QAbstractItemModel>
+#include <QtCore/QAbstractListModel>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QRectF>
+
+#include <list>
+#include <memory>
+
+class SplitLayoutModel;
+
+/**
+* The panes of a SplitLayoutModel as a flat list, in the order they were created.
+*
+* A pane keeps its row from its split() to its unsplit(), whatever happens to the tree around it, so a Repeater
+* keeps its delegate instance: layout changes only show up as changes of the rect role.
+*/
+class SplitLayoutPanes : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles { PaneIdRole = Qt::UserRole + 1, RectRole };
+
+    explicit SplitLayoutPanes(SplitLayoutModel* layout);
+
+    int rowCount(QModelIndex const& parent = {}) const override;
+    QVariant data(QModelIndex const& index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+private:
+    SplitLayoutModel* m_layout;
+    friend class SplitLayoutModel;
+};
+
+/**
+* The handles between neighbouring children of the containers of a SplitLayoutModel, see moveHandle(). The rect
+* of a handle is the (zero width) line between the two children, orientation is the one of the container.
+*/
+class SplitLayoutHandles : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles { RectRole = Qt::UserRole + 1, OrientationRole };
+
+    explicit SplitLayoutHandles(SplitLayoutModel* layout);
+
+    int rowCount(QModelIndex const& parent = {}) const override;
+    QVariant data(QModelIndex const& index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+private:
+    SplitLayoutModel* m_layout;
+    friend class SplitLayoutModel;
+};
+
+/**
+* The layout of the panes of a window: a tree whose leaves are the panes and whose inner nodes are containers
+* laying their children out side by side (Qt::Horizontal) or on top of each other (Qt::Vertical), each child
+* taking its share of the container. The root is always a container, it starts out with a single pane.
+*
+* Panes are identified by ids which are never reused. split(), unsplit() and the focus only follow the path from
+* the pane to the root, nothing walks the tree; rects are recomputed (and notified) for the container whose
+* children changed and what it holds, the handles included. Nodes know their rows in panes() and handles().
+*
+* The model exposes the tree itself (rows are children, see Roles) and, for the QML front-end (SplitLayout.qml),
+* the flat panes and handles lists.
+*
+* The focus history remembers the order the panes were focused in: unsplitting the focused pane focuses the pane
+* focused before it.
+*/
+class SplitLayoutModel : public QAbstractItemModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int focused READ focused WRITE setFocused NOTIFY focusedChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(QAbstractItemModel* panes READ panes CONSTANT)
+    Q_PROPERTY(QAbstractItemModel* handles READ handles CONSTANT)
+
+public:
+    enum Roles { PaneIdRole = Qt::UserRole + 1, OrientationRole, RectRole };
+
+    // The smallest share of its container a handle leaves a child
+    static constexpr qreal MinShare = 0.05;
+
+    explicit SplitLayoutModel(QObject* parent = nullptr);
+    ~SplitLayoutModel() override;
+
+    /**
+    * Splits pane in two along orientation and focuses the new pane. Returns the id of the new pane, or -1 if
+    * there is no such pane.
+    *
+    * \note The new pane goes next to pane in its container if that container has the same orientation (or pane is
+    *       its only child, the container then takes the orientation), otherwise pane is replaced by a new
+    *       container holding both.
+    */
+    Q_INVOKABLE int split(int pane, Qt::Orientation orientation);
+
+    /**
+    * Removes pane, its neighbour takes its space. A container left with a single child is replaced by that child.
+    * Returns false if there is no such pane or it is the last one.
+    */
+    Q_INVOKABLE bool unsplit(int pane);
+
+    /**
+    * Moves a handle (a row of handles()) to position, in the layout's normalized coordinates along the handle's
+    * orientation. Each of the two children keeps at least MinShare of their container.
+    */
+    Q_INVOKABLE void moveHandle(int handle, qreal position);
+
+    // A node of the tree as saved by records()
+    struct Record
+    {
+        int pane = -1;              // -1 for containers
+        Qt::Orientation orientation = Qt::Horizontal;
+        int children = 0;           // containers only
+        qreal share = 1;
+    };
+
+    // The tree in pre-order, each container followed by its children, e.g. for a session snapshot (see Session)
+    QList<Record> records() const;
+
+    /**
+    * Replaces the tree by one saved with records() and focuses the pane saved as focused. The panes get new ids,
+    * the returned hash maps the saved ids to them. Returns an empty hash and keeps the tree if records isn't a
+    * valid tree.
+    */
+    QHash<int, int> restore(QList<Record> const& records, int focused);
+
+    // The focused pane, -1 if there is none
+    int focused() const;
+    void setFocused(int pane);
+
+    // The number of panes
+    int count() const;
+
+    QAbstractItemModel* panes() const;
+    QAbstractItemModel* handles() const;
+
+    QModelIndex index(int row, int column, QModelIndex const& parent = {}) const override;
+    QModelIndex parent(QModelIndex const& index) const override;
+    int rowCount(QModelIndex const& parent = {}) const override;
+    int columnCount(QModelIndex const& parent = {}) const override;
+    QVariant data(QModelIndex const& index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+Q_SIGNALS:
+    void focusedChanged(int);
+    void countChanged(int);
+
+private:
+    struct Node;
+
+    struct Handle
+    {
+        Node* container = nullptr;
+        int index = 0;      // between the children index and index + 1, container->handles[index] is its row
+        QRectF rect;
+    };
+
+    QModelIndex indexOf(Node* node) const;
+    void insert(Node* parent, int row, std::unique_ptr<Node> node);
+    std::unique_ptr<Node> take(Node* node);
+    std::unique_ptr<Node> createPane();
+    void addHandle(Node* container);
+    void removeHandle(Node* container);
+    void layout(Node* node, QRectF const& rect, bool notify = true);
+    void layoutHandle(int row, bool notify);
+    void forget(int pane);
+
+    std::unique_ptr<Node> m_root;
+    QHash<int, Node*> m_nodes;      // the panes by id
+    QList<Node*> m_panes;           // the rows of m_paneModel
+    QList<Handle> m_handles;        // the rows of m_handleModel
+    int m_nextId = 0;
+
+    int m_focused = -1;
+    std::list<int> m_history;       // most recently focused last
+    QHash<int, std::list<int>::iterator> m_historyIndex;
+
+    SplitLayoutPanes* m_paneModel;
+    SplitLayoutHandles* m_handleModel;
+
+    friend class SplitLayoutPanes;
+    friend class SplitLayoutHandles;
+};
@@ -0,0 +1,238 @@
+#include "TimeSeries.h"
+#include "MappedMesh.h"
+#include "QQuickVtkTrace.h"
+
+#include <QtCore/QCollator>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QThread>
+
+#include <vtkPolyData.h>
+#include <vtkPolyDataAlgorithm.h>
+#include <vtkXMLPolyDataReader.h>
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <string>
+
+static QMutex s_timesMutex;
+static QHash<QString, QVector<double>> s_times;
+
+// How long a series counts as being prefetched after its last prefetch()
+static const qint64 s_prefetchWindow = 2000;
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+void registerTimeSeries(QString const& name, QVector<double> times, GeometryCache::Factory factory)
+{
+    if (times.isEmpty()) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! The time series" << name << "has no steps";
+        return;
+    }
+    if (!std::is_sorted(times.cbegin(), times.cend())) {
+        qWarning() << Q_FUNC_INFO << "YIKES!! The times of" << name << "aren't ascending";
+        return;
+    }
+
+    {
+        QMutexLocker lock(&s_timesMutex);
+        s_times.insert(name, std::move(times));
+    }
+    GeometryCache::instance().registerSource(name, std::move(factory));
+}
+
+QStringList registerTimeSeriesDirectories(QString const& directory)
+{
+    QStringList names;
+
+    QCollator collator;
+    collator.setNumericMode(true);
+
+    QDir dir(directory);
+    for (auto const& info : dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Readable, QDir::Name)) {
+        auto files = QDir(info.absoluteFilePath()).entryInfoList({ "*.mvmesh", "*.vtp" }, QDir::Files | QDir::Readable);
+        if (files.isEmpty())
+            continue;
+        std::sort(files.begin(), files.end(), [&collator](QFileInfo const& a, QFileInfo const& b) {
+            return collator.compare(a.fileName(), b.fileName()) < 0;
+        });
+
+        QVector<double> times(files.size());
+        std::iota(times.begin(), times.end(), 0.0);
+
+        QVector<std::string> paths;
+        for (auto const& file : std::as_const(files))
+            paths << file.absoluteFilePath().toStdString();
+
+        registerTimeSeries(info.fileName(), times, [paths](QVector<double> const& params) -> vtkSmartPointer<vtkPolyDataAlgorithm> {
+            auto const& path = paths[qBound(0, int(params.value(0)), int(paths.size()) - 1)];
+            if (QString::fromStdString(path).endsWith(".vtp")) {
+                auto reader = vtkSmartPointer<vtkXMLPolyDataReader>::New();
+                reader->SetFileName(path.c_str());
+                return reader;
+            }
+
+            auto reader = vtkSmartPointer<MappedMeshReader>::New();
+            reader->SetFileName(path);
+            return reader;
+        });
+        names << info.fileName();
+    }
+
+    return names;
+}
+
+QVector<double> timeSeriesTimes(QString const& source)
+{
+    QMutexLocker lock(&s_timesMutex);
+    return s_times.value(source);
+}
+
+/* -+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+- */
+
+TimeSeriesCache& TimeSeriesCache::instance()
+{
+    static TimeSeriesCache cache;
+    return cache;
+}
+
+TimeSeriesCache::TimeSeriesCache()
+{
+    // We might be first used from a render thread, stepReady() belongs to the GUI thread
+    if (auto* app = QCoreApplication::instance())
+        moveToThread(app->thread());
+
+    // Leave cores to the render threads, playback needs those as much as it needs the steps
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+    m_uptime.start();
+}
+
+GeometryCache::Handle TimeSeriesCache::get(QString const& source, int step)
+{
+    Key key(source, step);
+
+    QMutexLocker lock(&m_mutex);
+
+    if (auto it = m_entries.find(key); it != m_entries.end()) {
+        it->used = ++m_clock;
+        return it->handle;
+    }
+
+    if (!m_loading.contains(key))
+        load(source, step, 1);
+    return {};
+}
+
+void TimeSeriesCache::prefetch(QString const& source, QVector<int> const& steps)
+{
+    QMutexLocker lock(&m_mutex);
+
+    // The series being prefetched, e.g. by several panes playing, share half the budget
+    auto now = m_uptime.elapsed();
+    m_prefetching.insert(source, now);
+    for (auto it = m_prefetching.begin(); it != m_prefetching.end();)
+        it = now - *it > s_prefetchWindow ? m_prefetching.erase(it) : std::next(it);
+
+    // Judging by the steps of this series, or of all series until one of this is computed
+    qint64 computed = 0, bytes = 0, allComputed = 0, allBytes = 0;
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        ++allComputed;
+        allBytes += it->bytes;
+        if (it.key().first == source) {
+            ++computed;
+            bytes += it->bytes;
+        }
+    }
+    if (!computed) {
+        computed = allComputed;
+        bytes = allBytes;
+    }
+
+    // Nothing's known about the size of the steps until the first is computed
+    qint64 room = m_byteBudget / 2 / m_prefetching.size();
+    for (int step : steps) {
+        if (computed && (room -= bytes / computed) < 0)
+            break;
+
+        Key key(source, step);
+        if (auto it = m_entries.find(key); it != m_entries.end())
+            it->used = ++m_clock;
+        else if (!m_loading.contains(key))
+            load(source, step, 0);
+    }
+}
+
+// Called with m_mutex locked
+void TimeSeriesCache::load(QString const& source, int step, int priority)
+{
+    Key key(source, step);
+    m_loading.insert(key);
+
+    m_pool.start([this, key] {
+        GeometryCache::Handle handle;
+        {
+            QQuickVtkTrace::Scope trace("step");
+            handle = GeometryCache::instance().acquire({ key.first, { double(key.second) } });
+        }
+
+        {
+            QMutexLocker lock(&m_mutex);
+            m_loading.remove(key);
+            if (!handle)
+                return;
+
+            // A step which failed is kept as well, so it isn't computed again and again
+            Entry e;
+            e.handle = handle;
+            e.bytes = handle.polyData() ? qint64(handle.polyData()->GetActualMemorySize()) * 1024 : 0;
+            e.used = ++m_clock;
+            m_entries.insert(key, e);
+            m_bytes += e.bytes;
+            evict();
+        }
+
+        QMetaObject::invokeMethod(this, [this, key] { emit stepReady(key.first, key.second); }, Qt::QueuedConnection);
+        }, priority);
+}
+
+// Called with m_mutex locked
+void TimeSeriesCache::evict()
+{
+    if (m_bytes <= m_byteBudget)
+        return;
+
+    QList<QPair<quint64, Key>> lru;
+    lru.reserve(m_entries.size());
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it)
+        lru.append({ it->used, it.key() });
+    std::sort(lru.begin(), lru.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+
+    // Views still showing an evicted step keep it alive (in the GeometryCache) until they show another one
+    for (auto const& [used, key] : std::as_const(lru)) {
+        if (m_bytes <= m_byteBudget)
+            break;
+        m_bytes -= m_entries.take(key).bytes;
+    }
+}
+
+qint64 TimeSeriesCache::byteBudget() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_byteBudget;
+}
+
+void TimeSeriesCache::setByteBudget(qint64 bytes)
+{
+    QMutexLocker lock(&m_mutex);
+    m_byteBudget = bytes;
+    evict();
+}
+
+qint64 TimeSeriesCache::bytes() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_bytes;
+}
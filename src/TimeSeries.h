@@ -0,0 +1,95 @@
+#pragma once
+
+#include "GeometryCache.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QPair>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+
+/**
+* Registers a time-series source, e.g. the output of a simulation: a GeometryCache source named name whose only
+* parameter is the index of a step (the first step without one), of which MyVtkItem shows the step at its
+* currentTime. times are the times of the steps, ascending.
+*/
+void registerTimeSeries(QString const& name, QVector<double> times, GeometryCache::Factory factory);
+
+/**
+* Registers every subdirectory of directory holding .mvmesh or .vtp files as a time series named after the
+* subdirectory, its files being the steps in the (numeric) order of their names, one unit of time apart. Returns the
+* names of the registered series.
+*/
+QStringList registerTimeSeriesDirectories(QString const& directory);
+
+/**
+* The times of the steps of a time series registered by registerTimeSeries(), or an empty vector.
+*/
+QVector<double> timeSeriesTimes(QString const& source);
+
+/**
+* Process-wide LRU cache of the steps of time series, shared by all views: panes showing the same series share
+* the computed steps (through the GeometryCache), which stay in memory until the byte budget is exceeded. Steps
+* are computed on a thread pool of their own, the steps asked for by get() before those prefetched.
+*
+* \note Thread safe. stepReady() is emitted on the GUI thread.
+*/
+class TimeSeriesCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static TimeSeriesCache& instance();
+
+    /**
+    * Returns the step if it's computed, otherwise schedules computing it and returns an empty handle.
+    */
+    GeometryCache::Handle get(QString const& source, int step);
+
+    /**
+    * Schedules computing steps, in that order, which aren't computed yet. Only as many as fit half the byte budget
+    * (judging by the size of the steps computed so far) are, so prefetching doesn't evict what it prefetched. The
+    * series prefetched within the last seconds share that half evenly.
+    */
+    void prefetch(QString const& source, QVector<int> const& steps);
+
+    /**
+    * The memory computed steps may occupy, least recently used steps are evicted beyond it. 1 GiB by default.
+    */
+    qint64 byteBudget() const;
+    void setByteBudget(qint64 bytes);
+
+    qint64 bytes() const;
+
+Q_SIGNALS:
+    void stepReady(QString source, int step);
+
+private:
+    TimeSeriesCache();
+    void load(QString const& source, int step, int priority);
+    void evict();
+
+    using Key = QPair<QString, int>;
+
+    struct Entry
+    {
+        GeometryCache::Handle handle;
+        qint64 bytes = 0;
+        quint64 used = 0;
+    };
+
+    mutable QMutex m_mutex;
+    QHash<Key, Entry> m_entries;
+    QSet<Key> m_loading;
+    QHash<QString, qint64> m_prefetching;   // source -> m_uptime of its last prefetch()
+    QElapsedTimer m_uptime;
+    quint64 m_clock = 0;
+    qint64 m_bytes = 0;
+    qint64 m_byteBudget = qint64(1) << 30;
+    QThreadPool m_pool;
+};
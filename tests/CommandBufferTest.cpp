@@ -0,0 +1,154 @@
+// Replays QQuickVtkCommandBuffer into a VTK interactor and checks what VTK sees: merging, dropping and overflowing
+// keep the order of what isn't a move, and the merged wheel zooms as far as its steps.
+
+#include "src/QQuickVtkCommandBuffer.h"
+
+#include <QtCore/QDebug>
+#include <QtCore/QStringList>
+#include <QtGui/QGuiApplication>
+#include <QtGui/QKeyEvent>
+#include <QtGui/QMouseEvent>
+#include <QtGui/QWheelEvent>
+
+#include <vtkCallbackCommand.h>
+#include <vtkCamera.h>
+#include <vtkGenericOpenGLRenderWindow.h>
+#include <vtkGenericRenderWindowInteractor.h>
+#include <vtkInteractorStyleTrackballCamera.h>
+#include <vtkNew.h>
+#include <vtkRenderer.h>
+
+#include <QVTKInteractorAdapter.h>
+
+#include <cmath>
+
+namespace
+{
+    struct Fixture
+    {
+        Fixture()
+        {
+            window->AddRenderer(renderer);
+            iren->SetRenderWindow(window);
+            iren->SetInteractorStyle(style);
+            renderer->GetActiveCamera()->SetPosition(0, 0, 10);
+
+            observer->SetClientData(this);
+            observer->SetCallback([](vtkObject*, unsigned long event, void* self, void*) {
+                auto* f = static_cast<Fixture*>(self);
+                if (event == vtkCommand::MouseMoveEvent)
+                    f->log << QString("M%1").arg(f->iren->GetEventPosition()[0]);
+                else if (event == vtkCommand::KeyPressEvent)
+                    f->log << "K";
+                else if (event == vtkCommand::MouseWheelForwardEvent)
+                    f->log << "W";
+            });
+            for (auto event : { vtkCommand::MouseMoveEvent, vtkCommand::KeyPressEvent, vtkCommand::MouseWheelForwardEvent })
+                iren->AddObserver(event, observer);
+        }
+
+        QStringList replay()
+        {
+            log.clear();
+            buffer.replay(adapter, window, nullptr);
+            return log;
+        }
+
+        void move(int x)
+        {
+            QMouseEvent e(QEvent::MouseMove, QPointF(x, 0), QPointF(x, 0), QPointF(x, 0), Qt::NoButton, Qt::NoButton, Qt::NoModifier);
+            buffer.push(&e);
+        }
+
+        void key()
+        {
+            QKeyEvent e(QEvent::KeyPress, Qt::Key_A, Qt::NoModifier, "a");
+            buffer.push(&e);
+        }
+
+        void wheel(int delta)
+        {
+            QWheelEvent e(QPointF(), QPointF(), QPoint(), QPoint(0, delta), Qt::NoButton, Qt::NoModifier, Qt::NoScrollPhase, false);
+            buffer.push(&e);
+        }
+
+        QQuickVtkCommandBuffer buffer;
+        QVTKInteractorAdapter adapter;
+        vtkNew<vtkGenericOpenGLRenderWindow> window;
+        vtkNew<vtkRenderer> renderer;
+        vtkNew<vtkGenericRenderWindowInteractor> iren;
+        vtkNew<vtkInteractorStyleTrackballCamera> style;
+        vtkNew<vtkCallbackCommand> observer;
+        QStringList log;
+    };
+
+    int failures = 0;
+
+    void check(bool ok, const char* what)
+    {
+        if (!ok) {
+            qWarning() << "FAILED:" << what;
+            ++failures;
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    QGuiApplication app(argc, argv);
+
+    Fixture f;
+    const int n = QQuickVtkCommandBuffer::Capacity;
+
+    // A full arena gives up its oldest moves, never the keys between them
+    for (int i = 0; i < 200; ++i) {
+        f.move(i);
+        f.key();
+    }
+    check(f.buffer.size() == n, "a full arena holds Capacity commands");
+    check(f.buffer.dropped == quint64(400 - n), "the moves beyond Capacity are dropped");
+
+    QStringList expected;
+    for (int i = 0; i < 200; ++i) {
+        if (i >= 400 - n)
+            expected << QString("M%1").arg(i);
+        expected << "K";
+    }
+    check(f.replay() == expected, "the oldest moves are dropped, everything else is replayed in order");
+    check(f.buffer.isEmpty(), "replaying empties the buffer");
+
+    // Merging into slots reused in another order than they were first handed out
+    auto distance = f.renderer->GetActiveCamera()->GetDistance();
+    auto merged = f.buffer.merged;
+    f.move(1);
+    f.move(2);
+    f.wheel(120);
+    f.wheel(120);
+    f.wheel(120);
+    f.key();
+    check(f.buffer.size() == 3 && f.buffer.merged == merged + 3, "consecutive moves and wheel steps merge after the arena wrapped");
+    check(f.replay() == QStringList({ "M2", "W", "K" }), "a merged move is replayed at its last position, the merged wheel once");
+
+    // Trackball camera dollies by 1.1^(MotionFactor * 0.2 * MouseWheelMotionFactor) per step
+    auto expectedDistance = distance / std::pow(1.1, 3 * 10 * 0.2);
+    check(std::abs(f.renderer->GetActiveCamera()->GetDistance() - expectedDistance) < 1e-9 * distance, "the merged wheel zooms as far as its steps");
+    check(f.style->GetMouseWheelMotionFactor() == 1, "the style's wheel factor is restored");
+
+    // Without a move to drop the commands overflow, and keep merging there
+    for (int i = 0; i < n; ++i)
+        f.key();
+    f.move(1);
+    f.move(2);
+    check(f.buffer.size() == n + 1, "commands beyond a full arena without moves overflow");
+
+    expected = QStringList();
+    for (int i = 0; i < n; ++i)
+        expected << "K";
+    expected << "M2";
+    check(f.replay() == expected, "the overflow is replayed after the arena, merged");
+
+    f.key();
+    check(f.replay() == QStringList({ "K" }), "the arena is used again once the overflow was replayed");
+
+    return failures ? 1 : 0;
+}
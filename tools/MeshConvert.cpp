@@ -0,0 +1,119 @@
+#include "src/MappedMesh.h"
+#include "src/PointCloud.h"
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtCore/QFileInfo>
+
+#include <vtkNew.h>
+#include <vtkPLYReader.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataNormals.h>
+#include <vtkSTLReader.h>
+#include <vtkTriangleFilter.h>
+#include <vtkXMLPolyDataReader.h>
+
+// Converts VTP, STL and PLY files to the memory-mappable .mvmesh format, see src/MappedMesh.h, or to the
+// out-of-core .mvoct point cloud format, see src/PointCloud.h
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("MeshConvert");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts a VTP, STL or PLY mesh to a memory-mappable .mvmesh file or its points to an .mvoct point cloud");
+    parser.addHelpOption();
+    parser.addPositionalArgument("input", "The .vtp, .stl or .ply file to convert.");
+    parser.addPositionalArgument("output", "The .mvmesh or .mvoct file to write (default: input with .mvmesh suffix).");
+    QCommandLineOption normalsOption("normals", "Compute point normals, replacing those of the input.");
+    parser.addOption(normalsOption);
+    QCommandLineOption checkOption("check", "Check every cell of the input .mvmesh file instead of converting it.");
+    parser.addOption(checkOption);
+    parser.process(app);
+
+    auto args = parser.positionalArguments();
+    if (args.isEmpty() || args.size() > 2)
+        parser.showHelp(1);
+
+    // Opening an .mvmesh file only checks its header, see MappedMeshReader
+    if (parser.isSet(checkOption)) {
+        QString error;
+        if (!checkMappedMesh(args[0], &error)) {
+            qCritical() << "YIKES!! Corrupt:'" << args[0] << "'" << error;
+            return 1;
+        }
+
+        qInfo().noquote() << args[0] << ": OK";
+        return 0;
+    }
+
+    QFileInfo input(args[0]);
+    auto output = args.size() > 1 ? args[1] : input.path() + "/" + input.completeBaseName() + ".mvmesh";
+
+    vtkSmartPointer<vtkPolyDataAlgorithm> reader;
+    auto suffix = input.suffix().toLower();
+    auto path = input.filePath().toStdString();
+    if (suffix == "vtp") {
+        auto r = vtkSmartPointer<vtkXMLPolyDataReader>::New();
+        r->SetFileName(path.c_str());
+        reader = r;
+    } else if (suffix == "stl") {
+        auto r = vtkSmartPointer<vtkSTLReader>::New();
+        r->SetFileName(path.c_str());
+        reader = r;
+    } else if (suffix == "ply") {
+        auto r = vtkSmartPointer<vtkPLYReader>::New();
+        r->SetFileName(path.c_str());
+        reader = r;
+    } else {
+        qCritical() << "YIKES!! Unsupported input format:'" << input.filePath() << "'";
+        return 1;
+    }
+
+    // Point clouds keep the points (and colors) only
+    if (QFileInfo(output).suffix().toLower() == "mvoct") {
+        reader->Update();
+
+        auto* polyData = reader->GetOutput();
+        QString error;
+        if (!writePointCloud(polyData, output, &error)) {
+            qCritical() << "YIKES!! Can't write:'" << output << "'" << error;
+            return 1;
+        }
+
+        qInfo().noquote() << output << ":" << polyData->GetNumberOfPoints() << "points";
+        return 0;
+    }
+
+    // Polygons only (strips become triangles, vertices and lines are dropped)
+    vtkNew<vtkTriangleFilter> triangles;
+    triangles->SetInputConnection(reader->GetOutputPort());
+    triangles->PassVertsOff();
+    triangles->PassLinesOff();
+
+    vtkSmartPointer<vtkPolyDataAlgorithm> last = triangles;
+    if (parser.isSet(normalsOption)) {
+        auto normals = vtkSmartPointer<vtkPolyDataNormals>::New();
+        normals->SetInputConnection(triangles->GetOutputPort());
+        normals->SplittingOff();
+        normals->ComputePointNormalsOn();
+        normals->ComputeCellNormalsOff();
+        last = normals;
+    }
+    last->Update();
+
+    auto* polyData = last->GetOutput();
+    if (!polyData->GetNumberOfPoints()) {
+        qCritical() << "YIKES!! No geometry read from:'" << input.filePath() << "'";
+        return 1;
+    }
+    QString error;
+    if (!writeMappedMesh(polyData, output, &error)) {
+        qCritical() << "YIKES!! Can't write:'" << output << "'" << error;
+        return 1;
+    }
+
+    qInfo().noquote() << output << ":" << polyData->GetNumberOfPoints() << "points," << polyData->GetNumberOfPolys() << "triangles";
+    return 0;
+}